@@ -1,12 +1,50 @@
 #include "Application.h"
 
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <set>
+#include <thread>
 #include <vector>
 
-constexpr int cmaxFramesInFlight = 2;
+//the per frame pools of the recorders, profiler and staging ring are made for this many frames
+//how many are really in flight is framesInFlight, set at runtime
+constexpr uint32_t cmaxFramesInFlight = 3;
+constexpr uint32_t cdefaultFramesInFlight = 2;
+
+//per draw uniforms take 256 bytes at most once aligned, that is at least 16k draws a frame
+constexpr VkDeviceSize cframeTransientSize = 4 * 1024 * 1024;
+
+//under this many draws, waking up the recording threads costs more than it saves
+constexpr size_t cparallelRecordingThreshold = 2048;
+
+//as many as a swap chain would have, so headless frames overlap the same way
+constexpr uint32_t coffscreenImageCount = 3;
+constexpr VkFormat coffscreenFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+constexpr VkDeviceSize cstagingRingSize = 16ull * 1024 * 1024;
+
+//same syntax as --device, an index or a part of the name
+constexpr const char* cdeviceSelectorVariable = "VULKAN_DISCOVERY_DEVICE";
+
+//delete this file to measure a cold start
+constexpr const char* cpipelineCachePath = "pipeline_cache.bin";
+constexpr const char* cpipelineListPath = "pipelines.txt";
+//no shader declares it, it only makes the benchmark's pipeline variants different states
+constexpr uint32_t cpipelineVariantConstantID = 1000;
+
+//clamped to the device's limits by the heap
+constexpr uint32_t cbindlessMaxImages = 16384;
+constexpr uint32_t cbindlessMaxBuffers = 16384;
+constexpr uint32_t cbindlessMaxSamplers = 256;
+
+//sizes the indirect draw buffers, 20 bytes per object and frame in flight, lowered to maxDrawIndirectCount
+constexpr uint32_t cmaxGpuObjects = 131072;
 
 const std::vector<const char*> validationLayers =
 {
@@ -28,16 +66,29 @@ static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 	std::cout << "eyy" << std::endl;
 }
 
-Application::Application(int32_t height, int32_t width, const char* windowName)
-	: height(height), width(width)
+Application::Application(int32_t height, int32_t width, const char* windowName, bool headless, const char* deviceSelector)
+	: height(height), width(width), headless(headless), deviceSelector(deviceSelector), framesInFlight(cdefaultFramesInFlight)
 {
-	glfwInit();
+	auto startupBegin = std::chrono::high_resolution_clock::now();
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	window = glfwCreateWindow(width, height, windowName, nullptr, nullptr);
+	CpuProfiler::setThreadName("render thread");
 
-	glfwSetWindowUserPointer(window, this);
-	glfwSetWindowSizeCallback(window, framebufferResizeCallback);
+	if(headless)
+	{
+		//no window system at all, so it runs on machines without a display
+		window = nullptr;
+		deviceExtensions.clear();
+	}
+	else
+	{
+		glfwInit();
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		window = glfwCreateWindow(width, height, windowName, nullptr, nullptr);
+
+		glfwSetWindowUserPointer(window, this);
+		glfwSetWindowSizeCallback(window, framebufferResizeCallback);
+	}
 
 	uint32_t availableLayersCount;
 	vkEnumerateInstanceLayerProperties(&availableLayersCount, nullptr);
@@ -55,17 +106,52 @@ Application::Application(int32_t height, int32_t width, const char* windowName)
 	info.applicationVersion= VK_MAKE_VERSION(1, 0, 0);
 	info.apiVersion = VK_API_VERSION_1_0;
 
+	//vkEnumerateInstanceVersion doesn't exist on a 1.0 loader, it has to be looked up
+	auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+		vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+
+	if (enumerateInstanceVersion)
+		enumerateInstanceVersion(&loaderVersion);
+
+	//1.2 brings the timeline semaphores, the device still has to support them (see pickLogicalDevice)
+	if (loaderVersion >= VK_API_VERSION_1_2)
+		info.apiVersion = VK_API_VERSION_1_2;
+
+	instanceApiVersion = info.apiVersion;
+
 	VkInstanceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	createInfo.pApplicationInfo = &info;
 
 	uint32_t extensionRequired = 0;
-	const char** extensionName;
+	const char** extensionName = nullptr;
+
+	if (!headless)
+		extensionName = glfwGetRequiredInstanceExtensions(&extensionRequired);
+
+	uint32_t extensionAvailable;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionAvailable, nullptr);
 
-	extensionName = glfwGetRequiredInstanceExtensions(&extensionRequired);
+	std::vector<VkExtensionProperties> props(extensionAvailable);
+
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionAvailable, props.data());
+
+	std::vector<const char*> instanceExtensions(extensionName, extensionName + extensionRequired);
+
+	//optional, lets the allocator query the real memory budget
+	for(const VkExtensionProperties& prop : props)
+	{
+		if(strcmp(prop.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+		{
+			instanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			physicalDeviceProperties2Enabled = true;
+		}
+	}
 
-	createInfo.enabledExtensionCount = extensionRequired;
-	createInfo.ppEnabledExtensionNames = extensionName;
+	createInfo.enabledExtensionCount = instanceExtensions.size();
+	createInfo.ppEnabledExtensionNames = instanceExtensions.data();
 
 	if (enableValidationLayer)
 	{
@@ -88,13 +174,6 @@ Application::Application(int32_t height, int32_t width, const char* windowName)
 		//ay caramba
 		std::cout << "Ay caramba" << std::endl;
 	}
-	
-	uint32_t extensionAvailable;
-	vkEnumerateInstanceExtensionProperties(nullptr, &extensionAvailable, nullptr);
-
-	std::vector<VkExtensionProperties> props(extensionAvailable);
-
-	vkEnumerateInstanceExtensionProperties(nullptr, &extensionAvailable, props.data());
 
 	std::cout << "Available extensions" << std::endl;
 	for(const VkExtensionProperties& prop : props)
@@ -104,51 +183,143 @@ Application::Application(int32_t height, int32_t width, const char* windowName)
 
 	std::cout << "Needed extensions" << std::endl;
 
-	for(uint32_t i = 0; i < extensionRequired; i++)
+	for(const char* extension : instanceExtensions)
 	{
-		std::cout << extensionName[i] << std::endl;
+		std::cout << extension << std::endl;
 	}
 
-	createSurface();
+	if (!headless)
+		createSurface();
 
 	pickPhysicalDevice();
 	pickLogicalDevice();
 
-	createSwapChain();
+	memoryAllocator.init(instance, physicalDevice, logicalDevice, cmaxFramesInFlight, memoryBudgetEnabled);
+
+	pipelineCache.init(logicalDevice, physicalDevice, cpipelineCachePath);
+	layoutCache.init(logicalDevice);
+
+	if (bindlessEnabled)
+		bindlessHeap.init(instance, logicalDevice, physicalDevice, cbindlessMaxImages, cbindlessMaxBuffers, cbindlessMaxSamplers);
+	else
+		std::cout << "No descriptor indexing, the pipelines are made without the bindless heap" << std::endl;
+
+	pipelineManager.init(logicalDevice, pipelineCache, layoutCache, bindlessHeap.getLayout(), cpipelineListPath);
+
+	if (headless)
+		createOffscreenTargets();
+	else
+		createSwapChain();
+
 	createImageViews();
 	createRenderPass();
+	//every pipeline the last run made, the first frames asking for them won't stall on their compilation
+	pipelineManager.prewarm(renderPass, swapChainImageFormat);
 	createGraphicsPipeline();
 	createFrameBuffer();
 	createCommandPool();
-	createCommandBuffers();
-	createSemaphores();
+	createStagingRing();
+	createGpuProfiler();
+	createAsyncCompute();
+	createFrameContexts();
+	instanceBatcher.init(memoryAllocator, cmaxFramesInFlight);
+
+	if(drawIndirectFirstInstanceEnabled)
+	{
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+		indirectRenderer.init(logicalDevice, memoryAllocator, layoutCache, pipelineCache, cmaxFramesInFlight, cmaxGpuObjects,
+			drawIndirectCountEnabled, multiDrawIndirectEnabled, deviceProperties.limits);
+	}
+
+	uint32_t hardwareThreads = std::thread::hardware_concurrency();
+	createRecordingThreads(hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+
+	createMesh();
+
+	fileLoader.init();
+
+	//only useful with a window to look at
+	if (!headless)
+		startShaderHotReload();
+
+	drawList.push_back({ mesh.indexCount, 1, 0, 0, 0 });
+
+	auto startupEnd = std::chrono::high_resolution_clock::now();
+	std::cout << "Startup took " << std::chrono::duration<double, std::milli>(startupEnd - startupBegin).count()
+		<< " ms (" << (pipelineCache.isWarm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
 }
 
 Application::~Application()
 {
+	//the watcher can still be building a pipeline
+	shaderHotReload.destroy();
+	discardReloadedPipelines();
+
+	fileLoader.destroy();
+
+	deletionQueue.flushAll();
+
 	cleanSwapChain();
+	cleanPipeline();
+	pipelineManager.destroy();
 
-	vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+	destroyRecordingThreads();
+	commandRecorder.destroy();
+
+	stagingRing.destroy();
+	destroyMesh();
+
+	indirectRenderer.destroy();
+	memoryAllocator.destroyBuffer(gpuObjects);
+
+	gpuProfiler.destroy();
+	asyncCompute.destroy();
+
+	pipelineCache.destroy();
+
+	layoutCache.printStats();
+	layoutCache.destroy();
+	bindlessHeap.destroy();
+
+	destroyFrameContexts();
+	instanceBatcher.destroy();
+	graphicsTimeline.destroy();
+
+	memoryAllocator.printBudget();
+	memoryAllocator.destroy();
 
-	for(int i = 0; i < cmaxFramesInFlight; i++)
-	{
-		vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], nullptr);
-		vkDestroySemaphore(logicalDevice, renderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(logicalDevice, inFlightFences[i], nullptr);
-	}
 	
 	vkDestroyDevice(logicalDevice, nullptr);
 	
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (!headless)
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+
 	vkDestroyInstance(instance, nullptr);
 	
-	
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	if(!headless)
+	{
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+}
+
+void Application::exportTrace(const char* path)
+{
+	CpuProfiler::exportChromeTrace(path, gpuProfiler.getHistory());
 }
 
 void Application::run()
 {
+	if(headless)
+	{
+		std::cout << "There is no window to run in headless mode, use runFrames" << std::endl;
+		return;
+	}
+
+	CpuScope runScope("run");
+
 	while(!glfwWindowShouldClose(window))
 	{
 		glfwPollEvents();
@@ -162,24 +333,51 @@ void Application::run()
 
 	//waits for the device to finish up, before freeing allocated memory (dtor)
 	vkDeviceWaitIdle(logicalDevice);
+
+	gpuProfiler.printAverages();
 }
 
-std::vector<char> Application::readFile(const char* fileName)
+void Application::runFrames(uint32_t frameCount)
 {
-	std::ifstream file(fileName, std::ios::ate | std::ios::binary);
+	CpuScope runScope("runFrames");
+
+	auto start = std::chrono::high_resolution_clock::now();
 
-	if(!file.is_open())
+	uint32_t frame = 0;
+	for(; frame < frameCount && pollEvents(); frame++)
 	{
-		std::cout << "failed to open " << fileName << std::endl;
+		drawFrame();
 	}
 
-	size_t fileSize = file.tellg();
-	std::vector<char> buffer(fileSize);
+	vkDeviceWaitIdle(logicalDevice);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	std::cout << "Rendered " << frame << " frames" << (headless ? " headless" : "") << " in " << ms << " ms ("
+		<< (ms > 0.0 ? frame * 1000.0 / ms : 0.0) << " fps)" << std::endl;
+
+	gpuProfiler.printAverages();
+}
+
+void Application::notePresent()
+{
+	auto now = std::chrono::high_resolution_clock::now();
+
+	if (frameNumber > 1)
+		lastPresentIntervalMs = std::chrono::duration<double, std::milli>(now - lastPresentTime).count();
+
+	lastPresentTime = now;
+}
+
+bool Application::pollEvents()
+{
+	if (headless)
+		return true;
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+	glfwPollEvents();
 
-	return buffer;
+	return !glfwWindowShouldClose(window);
 }
 
 void Application::cleanSwapChain()
@@ -189,18 +387,180 @@ void Application::cleanSwapChain()
 		vkDestroyFramebuffer(logicalDevice, framebuffer, nullptr);
 	}
 
-	vkFreeCommandBuffers(logicalDevice, commandPool, commandBuffers.size(), commandBuffers.data());
-
-	vkDestroyPipeline(logicalDevice, pipeline, nullptr);
-	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
-	vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
-
 	for (auto imageView : swapChainImageViews)
 	{
 		vkDestroyImageView(logicalDevice, imageView, nullptr);
 	}
 
-	vkDestroySwapchainKHR(logicalDevice, swapchain, nullptr);
+	for (FImage& image : offscreenImages)
+	{
+		memoryAllocator.destroyImage(image);
+	}
+
+	offscreenImages.clear();
+
+	if (swapchain != VK_NULL_HANDLE)
+		vkDestroySwapchainKHR(logicalDevice, swapchain, nullptr);
+}
+
+void Application::cleanPipeline()
+{
+	//the pipelines are destroyed by the pipeline manager
+	pipeline = VK_NULL_HANDLE;
+	pipelineVariants.clear();
+
+	vkDestroyRenderPass(logicalDevice, renderPass, nullptr);
+}
+
+void Application::retireSwapChain(VkSwapchainKHR oldSwapchain)
+{
+	//the frames in flight can still be rendering into these, so they are destroyed once their fences signaled
+	//the old swap chain is kept alive until then too, the new one was created from it
+	deletionQueue.push(frameNumber, [device = logicalDevice, framebuffers = swapChainFramebuffers, views = swapChainImageViews, oldSwapchain]()
+	{
+		for (auto framebuffer : framebuffers)
+		{
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+
+		for (auto imageView : views)
+		{
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+
+		vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+	});
+
+	swapChainFramebuffers.clear();
+	swapChainImageViews.clear();
+}
+
+void Application::retirePipeline()
+{
+	//the pipelines of the old format stay in the pipeline manager, it goes back to them if the format does
+	deletionQueue.push(frameNumber, [device = logicalDevice, oldRenderPass = renderPass]()
+	{
+		vkDestroyRenderPass(device, oldRenderPass, nullptr);
+	});
+}
+
+void Application::setPipelineVariants(uint32_t variantCount)
+{
+	std::lock_guard<std::mutex> lock(shaderReloadMutex);
+	discardReloadedPipelines();
+
+	//only the pipelines change, the render pass and the layout are kept
+	std::vector<VkPipeline> replaced = pipelineVariants;
+	replaced.push_back(pipeline);
+
+	pipelineVariantCount = variantCount;
+	createPipelines();
+
+	//the pipeline itself is the same state, it comes back from the cache and stays
+	retirePipelines(std::move(replaced));
+}
+
+void Application::startShaderHotReload()
+{
+	std::vector<ShaderHotReload::FShaderSource> sources =
+	{
+		{ "Shaders/vertex.vert", "Shaders/vert.spv" },
+		{ "Shaders/frag.frag", "Shaders/frag.spv" }
+	};
+
+	shaderHotReload.init(sources, [this]()
+	{
+		//held for the whole build, the render pass, the format and the variant count can't change under it
+		std::lock_guard<std::mutex> lock(shaderReloadMutex);
+
+		VkPipeline builtPipeline = VK_NULL_HANDLE;
+		std::vector<VkPipeline> builtVariants;
+
+		//new resources in the shaders give another layout, it is swapped in with the pipelines
+		VkPipelineLayout builtLayout = VK_NULL_HANDLE;
+
+		if(!buildPipelines(builtLayout, builtPipeline, builtVariants))
+		{
+			std::cout << "The reloaded shaders don't build, keeping the current pipeline" << std::endl;
+			return;
+		}
+
+		//two reloads before a frame picked the first one up, only the last one is kept
+		discardReloadedPipelines();
+
+		reloadedPipeline = builtPipeline;
+		reloadedVariants = std::move(builtVariants);
+		reloadedLayout = builtLayout;
+	});
+}
+
+void Application::applyReloadedPipelines()
+{
+	//a build holds the lock, the frame goes on with the current pipeline rather than waiting for it
+	std::unique_lock<std::mutex> lock(shaderReloadMutex, std::try_to_lock);
+
+	if (!lock.owns_lock() || reloadedPipeline == VK_NULL_HANDLE)
+		return;
+
+	std::vector<VkPipeline> replaced = pipelineVariants;
+	replaced.push_back(pipeline);
+
+	pipeline = reloadedPipeline;
+	pipelineVariants = std::move(reloadedVariants);
+	//owned by the layout cache, the old one stays valid
+	pipelineLayout = reloadedLayout;
+	findDrawUniformLayout();
+
+	reloadedPipeline = VK_NULL_HANDLE;
+	reloadedVariants.clear();
+
+	//the frames in flight still draw with the old pipelines, they go once their fences signaled
+	//reverting the edit compiles them again, through the pipeline cache
+	retirePipelines(std::move(replaced));
+
+	std::cout << "Swapped in the reloaded pipeline" << std::endl;
+}
+
+void Application::findDrawUniformLayout()
+{
+	drawUniformLayout = VK_NULL_HANDLE;
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+
+	//a reloaded shader can drop the block, the draws don't bind the set then
+	if (layoutCache.getSetLayouts(pipelineLayout, setLayouts) && cdynamicUniformSet < setLayouts.size())
+		drawUniformLayout = setLayouts[cdynamicUniformSet];
+}
+
+void Application::discardReloadedPipelines()
+{
+	//still in the pipeline manager, the next retirePipelines takes them out
+	if (reloadedPipeline != VK_NULL_HANDLE)
+		discardedPipelines.push_back(reloadedPipeline);
+
+	discardedPipelines.insert(discardedPipelines.end(), reloadedVariants.begin(), reloadedVariants.end());
+
+	reloadedPipeline = VK_NULL_HANDLE;
+	reloadedVariants.clear();
+}
+
+void Application::retirePipelines(std::vector<VkPipeline> replaced)
+{
+	replaced.insert(replaced.end(), discardedPipelines.begin(), discardedPipelines.end());
+	discardedPipelines.clear();
+
+	//a reload of an unchanged shader or the same variant gives back the same handle
+	auto inUse = [this](VkPipeline candidate)
+	{
+		return candidate == VK_NULL_HANDLE || candidate == pipeline || candidate == instancedPipeline || candidate == indirectPipeline
+			|| candidate == reloadedPipeline
+			|| std::find(pipelineVariants.begin(), pipelineVariants.end(), candidate) != pipelineVariants.end()
+			|| std::find(reloadedVariants.begin(), reloadedVariants.end(), candidate) != reloadedVariants.end();
+	};
+
+	replaced.erase(std::remove_if(replaced.begin(), replaced.end(), inUse), replaced.end());
+
+	pipelineManager.retire(replaced, deletionQueue, frameNumber);
 }
 
 void Application::createSurface()
@@ -265,7 +625,8 @@ void Application::createSwapChain()
 	swapInfo.presentMode = presentMode;
 	swapInfo.clipped = VK_TRUE;
 
-	swapInfo.oldSwapchain = VK_NULL_HANDLE;
+	//lets the driver reuse the resources of the previous swap chain, and keeps its acquired images presentable
+	swapInfo.oldSwapchain = swapchain;
 
 	if(vkCreateSwapchainKHR(logicalDevice, &swapInfo, nullptr, &swapchain) != VK_SUCCESS)
 	{
@@ -280,6 +641,39 @@ void Application::createSwapChain()
 	swapChainImageFormat = surfaceFormat.format;
 }
 
+void Application::createOffscreenTargets()
+{
+	//stand in for the swap chain, the frames are rendered in these and nobody presents them
+	swapChainImageFormat = coffscreenFormat;
+	swapChainExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = swapChainImageFormat;
+	imageInfo.extent = { swapChainExtent.width, swapChainExtent.height, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	//transfer src so a test can read the result back
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	offscreenImages.resize(coffscreenImageCount);
+	swapChainImages.resize(coffscreenImageCount);
+
+	for(uint32_t i = 0; i < coffscreenImageCount; i++)
+	{
+		memoryAllocator.createImage(imageInfo, offscreenImages[i]);
+		swapChainImages[i] = offscreenImages[i].image;
+	}
+
+	std::cout << "Rendering headless into " << coffscreenImageCount << " offscreen images of "
+		<< swapChainExtent.width << "x" << swapChainExtent.height << std::endl;
+}
+
 void Application::createImageViews()
 {
 	swapChainImageViews.resize(swapChainImages.size());
@@ -327,7 +721,8 @@ void Application::createRenderPass()
 	//we don't care about the data remaining into the buffer, since we clear it
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	//but we care that after drawing to it, we are going to present it
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	//without a presentation engine the image is left ready to be copied out
+	colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentReference colorAttachmentRef{};
 	colorAttachmentRef.attachment = 0;
@@ -366,124 +761,90 @@ void Application::createRenderPass()
 
 void Application::createGraphicsPipeline()
 {
-	auto vertShaderCode = readFile("Shaders/vert.spv");
-	auto fragShaderCode = readFile("Shaders/frag.spv");
+	//the layout comes from the shaders now, createPipelines makes it with the pipelines
+	createPipelines();
+}
 
-	VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+void Application::createPipelines()
+{
+	if (!buildPipelines(pipelineLayout, pipeline, pipelineVariants))
+		std::cout << "Unable to create the pipeline" << std::endl;
 
-	VkPipelineShaderStageCreateInfo createVertexStageInfo{};
-	createVertexStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	createVertexStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	createVertexStageInfo.module = vertShaderModule;
-	createVertexStageInfo.pName = "main";
-	
-	//this is useful, used to tell constant values, useful for letting the compiler optimize things
-	//we don't use it here but cool to know
-	createVertexStageInfo.pSpecializationInfo = nullptr;
-
-	VkPipelineShaderStageCreateInfo createFragStageInfo{};
-	createFragStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	createFragStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	createFragStageInfo.module = fragShaderModule;
-	createFragStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo shaderStages[] = { createVertexStageInfo, createFragStageInfo };
-
-	//specifies the input of the vertex pipeline pass
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.pVertexBindingDescriptions = nullptr;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputInfo.pVertexAttributeDescriptions = nullptr;
-
-	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssembly.primitiveRestartEnable = VK_FALSE;
+	findDrawUniformLayout();
 
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = swapChainExtent.width;
-	viewport.height = swapChainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+	//same fragment shader and layout, the transforms come from the instance stream on binding 1
+	FGraphicsPipelineState instancedState;
+	instancedState.vertexShader = pipelineManager.registerShader("Shaders/instanced.spv");
+	instancedState.fragmentShader = pipelineManager.registerShader("Shaders/frag.spv");
 
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapChainExtent;
+	instancedPipeline = VK_NULL_HANDLE;
+	indirectPipeline = VK_NULL_HANDLE;
 
-	VkPipelineViewportStateCreateInfo viewportState{};
-	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportState.scissorCount = 1;
-	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
-	viewportState.pScissors = &scissor;
+	if(instancedState.vertexShader != 0 && instancedState.fragmentShader != 0)
+	{
+		instancedState.setVertexLayout(FVertex::getLayout());
+		instancedState.addVertexLayout(FInstance::getLayout());
+		instancedState.colorFormat = swapChainImageFormat;
 
-	VkPipelineRasterizationStateCreateInfo rasterizer{};
-	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizer.depthClampEnable = VK_FALSE;
-	rasterizer.rasterizerDiscardEnable = VK_FALSE;
-	rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizer.lineWidth = 1.0f;
-	rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+		instancedPipeline = pipelineManager.getPipeline(instancedState, renderPass);
 
-	//we can bias the depth at a rasterizer level, cool ! (useful for some cool shadows ;) )
-	rasterizer.depthBiasEnable = VK_FALSE;
+		//the object buffer has the bounds after the rows, only the stride changes
+		FGraphicsPipelineState indirectState = instancedState;
+		indirectState.setVertexLayout(FVertex::getLayout());
+		indirectState.addVertexLayout(FGpuObject::getLayout());
 
-	VkPipelineMultisampleStateCreateInfo multisampling{};
-	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	multisampling.sampleShadingEnable = VK_FALSE;
-	multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		indirectPipeline = pipelineManager.getPipeline(indirectState, renderPass);
+	}
 
-	//there are other options, but since we're not doing any blending i'm leaving the default
-	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_A_BIT | VK_COLOR_COMPONENT_B_BIT
-	| VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_R_BIT;
+	bindlessIndirectPipeline = VK_NULL_HANDLE;
 
-	VkPipelineColorBlendStateCreateInfo colorBlending{};
-	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	colorBlending.logicOpEnable = VK_FALSE;
-	colorBlending.attachmentCount = 1;
-	colorBlending.pAttachments = &colorBlendAttachment;
+	if(bindlessHeap.isValid())
+	{
+		//no instance stream, the vertex shader finds its object in the heap with gl_InstanceIndex
+		FGraphicsPipelineState bindlessState;
+		bindlessState.vertexShader = pipelineManager.registerShader("Shaders/objects.spv");
+		bindlessState.fragmentShader = pipelineManager.registerShader("Shaders/frag.spv");
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		if(bindlessState.vertexShader != 0 && bindlessState.fragmentShader != 0)
+		{
+			bindlessState.setVertexLayout(FVertex::getLayout());
+			bindlessState.colorFormat = swapChainImageFormat;
 
-	if(vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
-	{
-		std::cout << "Couldn't create pipeline layout" << std::endl;
+			bindlessIndirectPipeline = pipelineManager.getPipeline(bindlessState, renderPass, &bindlessIndirectLayout);
+		}
 	}
+}
 
-	VkGraphicsPipelineCreateInfo pipelineInfo{};
-	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
+bool Application::buildPipelines(VkPipelineLayout& builtLayout, VkPipeline& builtPipeline, std::vector<VkPipeline>& builtVariants)
+{
+	FGraphicsPipelineState state;
+	state.vertexShader = pipelineManager.registerShader("Shaders/vert.spv");
+	state.fragmentShader = pipelineManager.registerShader("Shaders/frag.spv");
+
+	if (state.vertexShader == 0 || state.fragmentShader == 0)
+		return false;
 
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &inputAssembly;
-	pipelineInfo.pViewportState = &viewportState;
-	pipelineInfo.pRasterizationState = &rasterizer;
-	pipelineInfo.pMultisampleState = &multisampling;
-	pipelineInfo.pColorBlendState = &colorBlending;
+	state.setVertexLayout(FVertex::getLayout());
+	state.colorFormat = swapChainImageFormat;
 
-	pipelineInfo.layout = pipelineLayout;
+	builtPipeline = pipelineManager.getPipeline(state, renderPass, &builtLayout);
 
-	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
+	bool built = builtPipeline != VK_NULL_HANDLE;
 
-	if(vkCreateGraphicsPipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)
-		!= VK_SUCCESS)
+	//the same state would give back the same pipeline, so each variant asks for a constant the shaders don't declare
+	//it changes nothing in the code but it's another pipeline, a real pipeline bind for the driver
+	builtVariants.resize(pipelineVariantCount);
+
+	for(uint32_t i = 0; i < pipelineVariantCount; i++)
 	{
-		std::cout << "Unable to create the pipeline" << std::endl;
+		state.specConstants = { { cpipelineVariantConstantID, i + 1 } };
+		builtVariants[i] = pipelineManager.getPipeline(state, renderPass);
+
+		if (builtVariants[i] == VK_NULL_HANDLE)
+			built = false;
 	}
 
-	vkDestroyShaderModule(logicalDevice, vertShaderModule, nullptr);
-	vkDestroyShaderModule(logicalDevice, fragShaderModule, nullptr);
+	return built;
 }
 
 void Application::createFrameBuffer()
@@ -516,142 +877,683 @@ void Application::createCommandPool()
 {
 	FQueueFamily queueFamilyIndices = queryQueueFamilies(physicalDevice);
 
-	VkCommandPoolCreateInfo poolInfo{};
-	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+	//one pool per frame in flight, the frame's commands are recorded again each time
+	commandRecorder.init(logicalDevice, queueFamilyIndices.graphicsFamily.value(), cmaxFramesInFlight);
+}
 
-	//this flag hints at how the pool should be treated
-	//if for example we want to modify only a handful of commands or all
-	poolInfo.flags = 0;
+void Application::createStagingRing()
+{
+	FQueueFamily queueFamilyIndices = queryQueueFamilies(physicalDevice);
+	uint32_t graphicsFamily = queueFamilyIndices.graphicsFamily.value();
 
-	if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
-	{
-		std::cout << "Unable to create the command pool" << std::endl;
-	}
+	if (queueFamilyIndices.transferFamily.has_value())
+		stagingRing.init(logicalDevice, memoryAllocator, cstagingRingSize, transferQueue, queueFamilyIndices.transferFamily.value(), graphicsFamily, cmaxFramesInFlight, timelineSemaphoreEnabled);
+	else
+		stagingRing.init(logicalDevice, memoryAllocator, cstagingRingSize, graphicsQueue, graphicsFamily, graphicsFamily, cmaxFramesInFlight, timelineSemaphoreEnabled);
 }
 
-void Application::createCommandBuffers()
+void Application::createGpuProfiler()
 {
-	commandBuffers.resize(swapChainFramebuffers.size());
+	FQueueFamily queueFamilyIndices = queryQueueFamilies(physicalDevice);
 
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.commandPool = commandPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = commandBuffers.size();
+	gpuProfiler.init(logicalDevice, physicalDevice, queueFamilyIndices.graphicsFamily.value(), cmaxFramesInFlight);
+}
 
-	if(vkAllocateCommandBuffers(logicalDevice, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-	{
-		std::cout << "Unable to create the command buffer" << std::endl;
-	}
+void Application::createAsyncCompute()
+{
+	FQueueFamily queueFamilyIndices = queryQueueFamilies(physicalDevice);
 
-	for(size_t i = 0; i < commandBuffers.size(); i++)
-	{
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		//beginInfo.flags -> usage of the buffer, useful for optimizing by re using stuff
+	if (queueFamilyIndices.computeFamily.has_value())
+		asyncCompute.init(logicalDevice, physicalDevice, computeQueue, queueFamilyIndices.computeFamily.value(), true, cmaxFramesInFlight, timelineSemaphoreEnabled);
+	else
+		asyncCompute.init(logicalDevice, physicalDevice, graphicsQueue, queueFamilyIndices.graphicsFamily.value(), false, cmaxFramesInFlight, timelineSemaphoreEnabled);
+}
 
-		if(vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
-		{
-			std::cout << "Unable to record command buffer no " << i << std::endl;
-		}
+void Application::createMesh()
+{
+	const std::vector<FVertex> vertices =
+	{
+		{ { 0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+		{ { 0.5f, 0.5f }, { 0.0f, 1.0f, 0.0f } },
+		{ { -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } }
+	};
 
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
+	const std::vector<uint32_t> indices = { 0, 1, 2 };
 
-		VkClearValue clearColor = { 0, 0, 0, 1.0f };
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
+	uploadMesh(vertices, indices);
+}
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+void Application::createGridMesh(uint32_t triangleCount)
+{
+	//a square grid of quads, two triangles each
+	uint32_t cells = std::max(1u, static_cast<uint32_t>(std::sqrt(triangleCount / 2.0)));
+	uint32_t columns = cells + 1;
 
-		vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-		vkCmdEndRenderPass(commandBuffers[i]);
+	std::vector<FVertex> vertices;
+	vertices.reserve(columns * columns);
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+	for(uint32_t y = 0; y < columns; y++)
+	{
+		for(uint32_t x = 0; x < columns; x++)
 		{
-			std::cout << "Unable to record the commands !" << std::endl;
+			float u = static_cast<float>(x) / cells;
+			float v = static_cast<float>(y) / cells;
+
+			vertices.push_back({ { u * 1.8f - 0.9f, v * 1.8f - 0.9f }, { u, v, 1.0f - u } });
 		}
 	}
-}
 
-void Application::createSemaphores()
-{
-	imageAvailableSemaphores.resize(cmaxFramesInFlight);
-	renderFinishedSemaphores.resize(cmaxFramesInFlight);
-	
-	VkSemaphoreCreateInfo semaphoreInfo{};
-	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	std::vector<uint32_t> indices;
+	indices.reserve(cells * cells * 6);
 
-	for(int i = 0; i < cmaxFramesInFlight; i++)
+	for(uint32_t y = 0; y < cells; y++)
 	{
-		if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS
-			|| vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
+		for(uint32_t x = 0; x < cells; x++)
 		{
-			std::cout << "Unable to create the semaphores" << std::endl;
+			uint32_t corner = y * columns + x;
+
+			indices.insert(indices.end(), { corner, corner + 1, corner + columns });
+			indices.insert(indices.end(), { corner + 1, corner + columns + 1, corner + columns });
 		}
 	}
 
-	createFences();
+	uploadMesh(vertices, indices);
 }
 
-void Application::createFences()
+void Application::uploadMesh(const std::vector<FVertex>& vertices, const std::vector<uint32_t>& indices)
 {
-	inFlightFences.resize(cmaxFramesInFlight);
-	imagesInFlight.resize(swapChainImages.size(), VK_NULL_HANDLE);
-	
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; //we're signaling that the frame is rendered, otherwise we will forever the first frame
-///	doesn't seem to change anything
-///	TODO: investigate why this ^
-	
-	for(int i = 0; i < cmaxFramesInFlight; i++)
+	if(!uploadBuffer(vertices.data(), vertices.size() * sizeof(FVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, mesh.vertexBuffer)
+		|| !uploadBuffer(indices.data(), indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, mesh.indexBuffer))
 	{
-		if (vkCreateFence(logicalDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
-		{
-			std::cout << "Unable to create fence !" << std::endl;
-		}
+		std::cout << "Unable to upload the mesh" << std::endl;
+		return;
 	}
-	
-}
 
-void Application::recreateSwapChain()
-{
-	std::cout << "Recreating the swap chain" << std::endl;
+	mesh.vertexCount = vertices.size();
+	mesh.indexCount = indices.size();
 
-	//are we minimized ?
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(window, &width, &height);
-	while (width == 0 || height == 0) {
-		glfwGetFramebufferSize(window, &width, &height);
-		glfwWaitEvents();
+	//around the center of the box, not the smallest sphere but close enough to cull with
+	glm::vec2 minPosition = vertices[0].position;
+	glm::vec2 maxPosition = vertices[0].position;
+
+	for(const FVertex& vertex : vertices)
+	{
+		minPosition = glm::min(minPosition, vertex.position);
+		maxPosition = glm::max(maxPosition, vertex.position);
 	}
-	
-	vkDeviceWaitIdle(logicalDevice);
 
+	glm::vec2 center = (minPosition + maxPosition) * 0.5f;
+	float radius = 0.0f;
 
-	cleanSwapChain();
-	
-	createSwapChain();
-	createImageViews(); // the images are changed since there is a new swapchain
-	createRenderPass(); // recreating the render pass, in case the format of the image changes
-	createGraphicsPipeline(); // Viewport and scissor have change so we need to recreate the pipeline (dynamic states can be used, as these two params can be changed with it without recreating a pipeline)
-	createFrameBuffer(); // depends on the images so we need to recreate them
-	createCommandBuffers(); // same thing as the framebuffers
+	for (const FVertex& vertex : vertices)
+		radius = std::max(radius, glm::length(vertex.position - center));
+
+	mesh.bounds = glm::vec4(center, 0.0f, radius);
 }
 
-void Application::drawFrame()
+void Application::loadBufferAsync(const char* path, VkBufferUsageFlags usage, std::function<void(const FBuffer&)>&& onUploaded)
 {
-	vkWaitForFences(logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	fileLoader.load(path, [this, usage, fileName = std::string(path), onUploaded = std::move(onUploaded)](MappedFile& file)
+	{
+		//the loader already said why it couldn't map it
+		if(!file.isOpen())
+		{
+			onUploaded(FBuffer{});
+			return;
+		}
+
+		//the only copy, from the mapping to the ring
+		FBuffer buffer;
+		if(!uploadBuffer(file.getData(), file.getSize(), usage, buffer))
+		{
+			std::cout << "Unable to upload " << fileName << std::endl;
+			onUploaded(FBuffer{});
+			return;
+		}
+
+		onUploaded(buffer);
+	});
+}
+
+bool Application::setGpuObjects(const std::vector<FGpuObject>& objects)
+{
+	if(!indirectRenderer.isValid() || indirectPipeline == VK_NULL_HANDLE)
+	{
+		std::cout << "No gpu driven draws, Shaders/cull.comp isn't compiled or the device lacks drawIndirectFirstInstance" << std::endl;
+		return false;
+	}
+
+	//the frames in flight may still be culling and drawing the old ones, their handle is given away with them
+	deletionQueue.push(frameNumber, [allocator = &memoryAllocator, heap = &bindlessHeap, oldObjects = gpuObjects, oldHandle = gpuObjectsHandle]() mutable
+	{
+		if (oldHandle != cinvalidBindlessHandle)
+			heap->release(EBindlessBinding::StorageBuffers, oldHandle);
+
+		allocator->destroyBuffer(oldObjects);
+	});
+
+	gpuObjects = FBuffer{};
+	gpuObjectsHandle = cinvalidBindlessHandle;
+	indirectRenderer.setObjects(VK_NULL_HANDLE, 0);
+
+	if (objects.empty())
+		return true;
+
+	//checked before the upload, the copy into the buffer is only recorded at the next flush
+	if(objects.size() > indirectRenderer.getMaxObjects())
+	{
+		std::cout << "Unable to draw " << objects.size() << " gpu objects, the device takes " << indirectRenderer.getMaxObjects() << std::endl;
+		return false;
+	}
+
+	//read by the culling, then by the vertex shader, per instance or through the heap
+	if(!uploadBuffer(objects.data(), objects.size() * sizeof(FGpuObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, gpuObjects,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT))
+	{
+		std::cout << "Unable to upload the " << objects.size() << " gpu objects" << std::endl;
+		return false;
+	}
+
+	if(!indirectRenderer.setObjects(gpuObjects.buffer, static_cast<uint32_t>(objects.size())))
+	{
+		//the queued copy still targets it and goes with the next frame, so it waits for that one too
+		deletionQueue.push(frameNumber + 1, [allocator = &memoryAllocator, rejectedObjects = gpuObjects]() mutable
+		{
+			allocator->destroyBuffer(rejectedObjects);
+		});
+
+		gpuObjects = FBuffer{};
+		return false;
+	}
+
+	//without the heap, or once its buffers are all taken, the rows are read as a vertex stream
+	if (bindlessHeap.isValid() && bindlessIndirectPipeline != VK_NULL_HANDLE)
+		gpuObjectsHandle = bindlessHeap.registerBuffer(gpuObjects.buffer);
+
+	return true;
+}
+
+void Application::retireMesh()
+{
+	//the frames in flight may still be drawing it
+	deletionQueue.push(frameNumber, [allocator = &memoryAllocator, oldMesh = mesh]() mutable
+	{
+		allocator->destroyBuffer(oldMesh.vertexBuffer);
+		allocator->destroyBuffer(oldMesh.indexBuffer);
+	});
+
+	mesh = FMesh{};
+}
+
+void Application::destroyMesh()
+{
+	memoryAllocator.destroyBuffer(mesh.vertexBuffer);
+	memoryAllocator.destroyBuffer(mesh.indexBuffer);
+	mesh = FMesh{};
+}
+
+bool Application::uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, FBuffer& buffer,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	if (memoryAllocator.createBuffer(EMemoryPool::StaticGeometry, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, buffer) != VK_SUCCESS)
+		return false;
+
+	if(!stagingRing.upload(data, size, buffer.buffer, 0, dstStage, dstAccess))
+	{
+		memoryAllocator.destroyBuffer(buffer);
+		return false;
+	}
+
+	return true;
+}
+
+void Application::recordFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	CpuScope recordScope("recordFrame");
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapChainExtent;
+
+	VkClearValue clearColor = { 0, 0, 0, 1.0f };
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearColor;
+
+	{
+		GpuScope passScope(gpuProfiler, commandBuffer, "main pass");
+
+		if(jobSystem.getThreadCount() > 0 && drawList.size() >= cparallelRecordingThreshold)
+		{
+			//the subpass can only contain vkCmdExecuteCommands now
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			recordDrawsParallel(commandBuffer, imageIndex);
+		}
+		else
+		{
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			recordDraws(commandBuffer, 0, drawList.size());
+			instanceBatcher.record(commandBuffer);
+			recordGpuDrivenDraws(commandBuffer);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	lastRecordMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Application::recordDrawsParallel(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	uint32_t workerCount = jobSystem.getThreadCount();
+	size_t sliceSize = (drawList.size() + workerCount - 1) / workerCount;
+
+	workerSecondaries.assign(workerCount, VK_NULL_HANDLE);
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+	jobSystem.dispatch([&](uint32_t worker)
+	{
+		size_t begin = worker * sliceSize;
+		size_t end = std::min(begin + sliceSize, drawList.size());
+
+		if (begin >= end)
+			return;
+
+		VkCommandBuffer secondary = workerRecorders[worker].allocateSecondary();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		if(vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS)
+		{
+			std::cout << "Unable to begin a secondary command buffer" << std::endl;
+			return;
+		}
+
+		{
+			CpuScope cpuSliceScope("record slice");
+			GpuScope sliceScope(gpuProfiler, secondary, "draw slice");
+			recordDraws(secondary, begin, end);
+		}
+
+		if(vkEndCommandBuffer(secondary) != VK_SUCCESS)
+		{
+			std::cout << "Unable to record a secondary command buffer" << std::endl;
+			return;
+		}
+
+		workerSecondaries[worker] = secondary;
+	});
+
+	//keeping the slices in order, so the draws are executed in the order of the list
+	uint32_t recorded = 0;
+	for(VkCommandBuffer secondary : workerSecondaries)
+	{
+		if (secondary != VK_NULL_HANDLE)
+			workerSecondaries[recorded++] = secondary;
+	}
+
+	workerSecondaries.resize(recorded);
+
+	//a handful of draws at most, not worth a worker
+	if(instanceBatcher.getBatchCount() > 0 || indirectRenderer.hasObjects())
+	{
+		VkCommandBuffer batchesSecondary = recordBatchesSecondary(inheritanceInfo);
+
+		if (batchesSecondary != VK_NULL_HANDLE)
+			workerSecondaries.push_back(batchesSecondary);
+	}
+
+	vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(workerSecondaries.size()), workerSecondaries.data());
+}
+
+VkCommandBuffer Application::recordBatchesSecondary(const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+	VkCommandBuffer secondary = commandRecorder.allocateSecondary();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	if(vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS)
+	{
+		std::cout << "Unable to begin a secondary command buffer" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	{
+		GpuScope batchesScope(gpuProfiler, secondary, "batches");
+		recordDrawState(secondary);
+		instanceBatcher.record(secondary);
+		recordGpuDrivenDraws(secondary);
+	}
+
+	if(vkEndCommandBuffer(secondary) != VK_SUCCESS)
+	{
+		std::cout << "Unable to record a secondary command buffer" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	return secondary;
+}
+
+void Application::pushDrawUniforms(FrameContext& frame)
+{
+	drawUniformSet = VK_NULL_HANDLE;
+	drawUniformOffsets.resize(drawList.size());
+
+	if (drawUniformLayout == VK_NULL_HANDLE || drawList.empty())
+		return;
+
+	//the range is one block, the dynamic offset picks which one
+	FDescriptorWrites writes;
+	writes.writeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frame.getTransientBuffer(), 0, sizeof(FDrawUniforms));
+
+	VkDescriptorSet set = frame.descriptors.getSet(drawUniformLayout, writes);
+
+	if (set == VK_NULL_HANDLE)
+		return;
+
+	//most lists repeat the same uniforms, a run of equal draws only takes one block of the buffer
+	const FDrawUniforms* previous = nullptr;
+	uint32_t offset = 0;
+
+	for(size_t i = 0; i < drawList.size(); i++)
+	{
+		const FDrawUniforms& uniforms = drawList[i].uniforms;
+
+		if(previous == nullptr || memcmp(previous, &uniforms, sizeof(FDrawUniforms)) != 0)
+		{
+			if(!frame.pushUniform(uniforms, offset))
+			{
+				std::cout << "Unable to write the uniforms of " << drawList.size() - i << " draws, the frame's transient buffer is full" << std::endl;
+
+				//the first draw has nothing to fall back on
+				if (previous == nullptr)
+					return;
+
+				//the draws left keep the last block that fit
+				std::fill(drawUniformOffsets.begin() + i, drawUniformOffsets.end(), offset);
+				break;
+			}
+
+			previous = &uniforms;
+		}
+
+		drawUniformOffsets[i] = offset;
+	}
+
+	drawUniformSet = set;
+}
+
+void Application::recordDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end)
+{
+	recordDrawState(commandBuffer);
+
+	mesh.bind(commandBuffer);
+
+	uint32_t boundPipeline = 0;
+	//the pipelines of the list share pipelineLayout, the set stays bound across their switches
+	bool uniformsBound = false;
+	uint32_t boundOffset = 0;
+
+	for(size_t i = begin; i < end; i++)
+	{
+		const FDrawItem& draw = drawList[i];
+
+		if(draw.pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline == 0 ? pipeline : pipelineVariants[draw.pipeline - 1]);
+			boundPipeline = draw.pipeline;
+		}
+
+		if(drawUniformSet != VK_NULL_HANDLE && (!uniformsBound || drawUniformOffsets[i] != boundOffset))
+		{
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, cdynamicUniformSet, 1, &drawUniformSet, 1, &drawUniformOffsets[i]);
+			uniformsBound = true;
+			boundOffset = drawUniformOffsets[i];
+		}
+
+		vkCmdDrawIndexed(commandBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+	}
+}
+
+void Application::recordDrawState(VkCommandBuffer commandBuffer)
+{
+	//the state is not inherited by secondary command buffers, so every slice sets it again
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+	//every layout starts with the heap, it stays bound whatever pipeline the draws switch to
+	if (bindlessHeap.isValid())
+		bindlessHeap.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout);
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = swapChainExtent.width;
+	viewport.height = swapChainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = swapChainExtent;
+
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void Application::recordGpuDrivenDraws(VkCommandBuffer commandBuffer)
+{
+	if(bindlessIndirectPipeline == VK_NULL_HANDLE || gpuObjectsHandle == cinvalidBindlessHandle)
+	{
+		indirectRenderer.recordDraws(commandBuffer, indirectPipeline, mesh);
+		return;
+	}
+
+	//its push constant makes the layout incompatible with pipelineLayout, so the heap is bound again for it
+	bindlessHeap.bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindlessIndirectLayout);
+	vkCmdPushConstants(commandBuffer, bindlessIndirectLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(uint32_t), &gpuObjectsHandle);
+
+	indirectRenderer.recordDraws(commandBuffer, bindlessIndirectPipeline, mesh);
+}
+
+void Application::createRecordingThreads(uint32_t threadCount)
+{
+	FQueueFamily queueFamilyIndices = queryQueueFamilies(physicalDevice);
+
+	workerRecorders.resize(threadCount);
+
+	for(CommandRecorder& recorder : workerRecorders)
+	{
+		recorder.init(logicalDevice, queueFamilyIndices.graphicsFamily.value(), cmaxFramesInFlight);
+	}
+
+	jobSystem.init(threadCount);
+}
+
+void Application::destroyRecordingThreads()
+{
+	jobSystem.destroy();
+
+	for(CommandRecorder& recorder : workerRecorders)
+	{
+		recorder.destroy();
+	}
+
+	workerRecorders.clear();
+}
+
+void Application::setRecordingThreads(uint32_t threadCount)
+{
+	//the pools of the current threads may still be used by the frames in flight
+	vkDeviceWaitIdle(logicalDevice);
+
+	destroyRecordingThreads();
+	createRecordingThreads(threadCount);
+}
+
+void Application::createFrameContexts()
+{
+	frames.resize(framesInFlight);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	for(FrameContext& frame : frames)
+	{
+		frame.init(logicalDevice, memoryAllocator, cframeTransientSize, deviceProperties.limits);
+	}
+
+	imagesInFlight.assign(swapChainImages.size(), 0);
+	currentFrame = 0;
+}
+
+void Application::destroyFrameContexts()
+{
+	for(FrameContext& frame : frames)
+	{
+		frame.destroy();
+	}
+
+	frames.clear();
+}
+
+void Application::setFramesInFlight(uint32_t count)
+{
+	count = std::min(std::max(count, 1u), cmaxFramesInFlight);
+
+	if (count == framesInFlight && !frames.empty())
+		return;
+
+	//every frame is done after this, so the contexts can go away at once
+	vkDeviceWaitIdle(logicalDevice);
+
+	completedFrames = frameNumber;
+	deletionQueue.flush(completedFrames);
+
+	destroyFrameContexts();
+
+	framesInFlight = count;
+	createFrameContexts();
+}
+
+void Application::recreateSwapChain()
+{
+	CpuScope recreateScope("recreateSwapChain");
+
+	std::cout << "Recreating the swap chain" << std::endl;
+
+	//are we minimized ?
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	while (width == 0 || height == 0) {
+		glfwGetFramebufferSize(window, &width, &height);
+		glfwWaitEvents();
+	}
+	
+	//no vkDeviceWaitIdle here, the frames in flight keep running on the old swap chain
+	//and everything they use is destroyed later through the deletion queue
+	VkSwapchainKHR oldSwapchain = swapchain;
+	VkFormat previousFormat = swapChainImageFormat;
+	
+	createSwapChain();
+	retireSwapChain(oldSwapchain);
+	createImageViews(); // the images are changed since there is a new swapchain
+
+	// viewport and scissor are dynamic states, so the render pass and the pipeline only depend on the format of the images
+	if(swapChainImageFormat != previousFormat)
+	{
+		std::cout << "Swap chain format changed, recreating the render pass and the pipeline" << std::endl;
+
+		std::lock_guard<std::mutex> lock(shaderReloadMutex);
+		discardReloadedPipelines();
+
+		retirePipeline();
+		createRenderPass();
+		createGraphicsPipeline();
+
+		//only the reloads of the old format, its pipelines stay cached for when it comes back
+		retirePipelines({});
+	}
+
+	//the images are new, none of them is used by a frame yet
+	imagesInFlight.assign(swapChainImages.size(), 0);
+	
+	createFrameBuffer(); // depends on the images so we need to recreate them
+
+	swapChainRecreations++;
+}
+
+void Application::drawFrame()
+{
+	CpuScope frameScope("drawFrame");
+
+	FrameContext& frame = frames[currentFrame];
+
+	waitForFrame(frame.submittedFrame);
+
+	//from the start of the last frame that used this context until it was seen done on the cpu
+	//an upper bound of its latency, the fence is only checked when the context comes around
+	if (frame.submittedFrame > 0)
+		lastFrameLatencyMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame.cpuStart).count();
+
+	frame.cpuStart = std::chrono::high_resolution_clock::now();
+	frame.reset();
+
+	deletionQueue.flush(completedFrames);
+
+	//between two frames, nothing recorded uses the pipeline yet
+	applyReloadedPipelines();
+
+	//the gpu is done with this slot's commands, its pools can be reset
+	commandRecorder.beginFrame(currentFrame);
+
+	for(CommandRecorder& recorder : workerRecorders)
+	{
+		recorder.beginFrame(currentFrame);
+	}
+
+	stagingRing.beginFrame(currentFrame);
+	asyncCompute.beginFrame(currentFrame, frameNumber);
+	instanceBatcher.beginFrame(currentFrame);
+	indirectRenderer.beginFrame(currentFrame);
+
+	//files mapped since the last frame go from their pages into the staging ring, and are uploaded with this frame
+	fileLoader.dispatchCompleted();
+
+	//reads back the timestamps of the last frame of this slot, its fence just signaled
+	gpuProfiler.beginFrame(currentFrame, frameNumber);
+
+	memoryAllocator.setFrameIndex(static_cast<uint32_t>(frameNumber));
 	
 	uint32_t imageIndex;
-	VkResult res = vkAcquireNextImageKHR(logicalDevice, swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	VkResult res = VK_SUCCESS;
+
+	if(headless)
+	{
+		//nothing to acquire, the offscreen images are used in turn
+		imageIndex = static_cast<uint32_t>(frameNumber % swapChainImages.size());
+	}
+	else
+	{
+		CpuScope acquireScope("vkAcquireNextImageKHR");
+		res = vkAcquireNextImageKHR(logicalDevice, swapchain, UINT64_MAX, frame.imageAvailable, VK_NULL_HANDLE, &imageIndex);
+	}
 
 	if (res == VK_ERROR_OUT_OF_DATE_KHR)
 	{
@@ -659,38 +1561,125 @@ void Application::drawFrame()
 		return; // we redraw from the top
 	}
 
-	if (imagesInFlight[currentFrame] != VK_NULL_HANDLE)
+	//the image can come back before the frame that last rendered to it is done, when there are more frames in flight than images
+	if (imagesInFlight[imageIndex] > completedFrames)
 	{
 		//we wait if the image we need is in use
-		vkWaitForFences(logicalDevice, 1, &imagesInFlight[currentFrame], VK_TRUE, UINT64_MAX);
+		CpuScope waitScope("wait for image");
+		waitForFrame(imagesInFlight[imageIndex]);
+	}
+
+	imagesInFlight[imageIndex] = frameNumber + 1;
+
+	FSubmitSync submitSync;
+
+	if (!headless)
+		submitSync.wait(frame.imageAvailable, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+
+	//the uploads queued since the last frame are copied on the transfer queue while this frame waits for them
+	stagingRing.flush(submitSync);
+
+	//submitted first, so it can start while the graphics commands are still being recorded
+	if(computePass && !computeOnGraphicsQueue)
+	{
+		VkCommandBuffer computeBuffer = asyncCompute.getCommandBuffer();
+
+		{
+			GpuScope computeScope(asyncCompute.getProfiler(), computeBuffer, "compute");
+			computePass(computeBuffer);
+		}
+
+		asyncCompute.submit(submitSync, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
 	}
 
-	imagesInFlight[currentFrame] = inFlightFences[currentFrame];
+	if(instancePass)
+	{
+		CpuScope instanceScope("instances");
+		instancePass(instanceBatcher);
+	}
 
+	//written before the recording, the secondaries of the parallel path only read the batches
+	instanceBatcher.upload();
+	pushDrawUniforms(frame);
+
+	VkCommandBuffer commandBuffer = commandRecorder.beginPrimary();
+	gpuProfiler.recordReset(commandBuffer);
+
+	{
+		GpuScope frameScope(gpuProfiler, commandBuffer, "frame");
+
+		stagingRing.recordAcquireBarriers(commandBuffer);
+
+		if(computePass && computeOnGraphicsQueue)
+		{
+			GpuScope computeScope(gpuProfiler, commandBuffer, "compute");
+			computePass(commandBuffer);
+		}
+
+		//on the graphics queue, the draws read its commands right after
+		if(indirectRenderer.hasObjects())
+		{
+			GpuScope cullingScope(gpuProfiler, commandBuffer, "culling");
+			indirectRenderer.recordCulling(commandBuffer, frame.descriptors, mesh);
+		}
+
+		recordFrame(commandBuffer, imageIndex);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		std::cout << "Unable to record the commands !" << std::endl;
+	}
+
+	frame.flushTransient();
 
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-	VkSemaphore waitSemaphore[] = { imageAvailableSemaphores[currentFrame] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphore;
-	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &commandBuffer;
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;	
-	
+	//presenting only takes binary semaphores, so renderFinished stays even with the timeline
+	VkSemaphore signalSemaphores[] = { frame.renderFinished };
+
+	if (!headless)
+		submitSync.signal(frame.renderFinished);
+
+	VkFence submitFence = VK_NULL_HANDLE;
 
-	vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
+	if(timelineSemaphoreEnabled)
+	{
+		submitSync.signalTimeline(graphicsTimeline, frameNumber + 1);
+	}
+	else
+	{
+		submitFence = frame.inFlightFence;
+		vkResetFences(logicalDevice, 1, &submitFence);
+	}
+
+	submitSync.apply(submitInfo);
 	
-	if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
 	{
-		std::cout << "Unable to submit the queue" << std::endl;
+		CpuScope submitScope("vkQueueSubmit");
+
+		if(vkQueueSubmit(graphicsQueue, 1, &submitInfo, submitFence) != VK_SUCCESS)
+		{
+			std::cout << "Unable to submit the queue" << std::endl;
+		}
 	}
 
+	CpuProfiler::markFrameSubmitted(frameNumber);
+
+	frameNumber++;
+	frame.submittedFrame = frameNumber;
+
+	if(headless)
+	{
+		//nothing is presented, the submit is the closest thing to it
+		notePresent();
+
+		currentFrame = (currentFrame + 1) % framesInFlight;
+		return;
+	}
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -703,7 +1692,12 @@ void Application::drawFrame()
 	presentInfo.swapchainCount = 1;
 	presentInfo.pImageIndices = &imageIndex;
 
-	res = vkQueuePresentKHR(presentQueue, &presentInfo);
+	{
+		CpuScope presentScope("vkQueuePresentKHR");
+		res = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+
+	notePresent();
 
 	//if the swapchain is not good er out of date(can't draw with that)
 	if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR || framebufferResized)
@@ -712,15 +1706,46 @@ void Application::drawFrame()
 		recreateSwapChain();
 	}
 
-	currentFrame = (currentFrame + 1) % cmaxFramesInFlight;
+	currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+void Application::waitForFrame(uint64_t value)
+{
+	if (value <= completedFrames)
+		return;
+
+	CpuScope waitScope("waitForFrame");
+
+	if(timelineSemaphoreEnabled)
+	{
+		graphicsTimeline.wait(value);
+		//the wait returns as soon as value is reached, later frames may be done too
+		completedFrames = std::max(completedFrames, graphicsTimeline.getCompletedValue());
+		return;
+	}
+
+	//the oldest context whose last frame is at least value, its fence covers everything submitted before it on the queue
+	FrameContext* oldest = nullptr;
+
+	for(FrameContext& frame : frames)
+	{
+		if (frame.submittedFrame >= value && (!oldest || frame.submittedFrame < oldest->submittedFrame))
+			oldest = &frame;
+	}
+
+	if (!oldest)
+		return;
+
+	vkWaitForFences(logicalDevice, 1, &oldest->inFlightFence, VK_TRUE, UINT64_MAX);
+	completedFrames = std::max(completedFrames, oldest->submittedFrame);
 }
 
-VkShaderModule Application::createShaderModule(const std::vector<char>& code)
+VkShaderModule Application::createShaderModule(const FSpirvView& code)
 {
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	createInfo.codeSize = code.size;
+	createInfo.pCode = code.code;
 	
 	VkShaderModule module;
 
@@ -767,19 +1792,51 @@ void Application::pickPhysicalDevice()
 	vkEnumeratePhysicalDevices(instance, &availableDevices, devices.data());
 
 	physicalDevice = VK_NULL_HANDLE;
+
+	std::vector<FDeviceRanking> rankings;
+	rankings.reserve(devices.size());
 	
-	for(const VkPhysicalDevice& device : devices)
+	for(uint32_t i = 0; i < devices.size(); i++)
 	{
-		if(canDeviceSupportExtensions(device))
+		FDeviceRanking ranking = rankPhysicalDevice(instance, devices[i], i, instanceApiVersion);
+		ranking.suitable = canDeviceSupportExtensions(devices[i]);
+
+		rankings.push_back(ranking);
+	}
+
+	sortDeviceRankings(rankings);
+	printDeviceRankings(rankings);
+
+	//--device on the command line, then the environment, then the best score
+	const char* selector = deviceSelector;
+
+	if (selector == nullptr)
+		selector = std::getenv(cdeviceSelectorVariable);
+
+	if(selector != nullptr)
+	{
+		int selected = findDeviceBySelector(rankings, selector);
+
+		if (selected < 0)
+			std::cout << "No device matches \"" << selector << "\", using the best one" << std::endl;
+		else if (!rankings[selected].suitable)
+			std::cout << rankings[selected].name << " was asked for but can't run this, using the best one" << std::endl;
+		else
 		{
-			physicalDevice = device;
+			physicalDevice = rankings[selected].device;
+			std::cout << "Using " << rankings[selected].name << ", asked for with \"" << selector << "\"" << std::endl;
+			return;
 		}
 	}
 
-	if(physicalDevice == VK_NULL_HANDLE)
+	if(rankings.empty() || !rankings.front().suitable)
 	{
 		std::cout << "No suitable devices found !" << std::endl;
+		return;
 	}
+
+	physicalDevice = rankings.front().device;
+	std::cout << "Using " << rankings.front().name << std::endl;
 }
 
 void Application::pickLogicalDevice()
@@ -792,7 +1849,17 @@ void Application::pickLogicalDevice()
 	//we're creating the queues to send commands
 	//in some cases the two queues can be in different devices that's why we use a set
 	//if it's the same they will have te same val
-	std::set<uint32_t> queueValues = { families.graphicsFamily.value(), families.presentFamily.value() };
+	std::set<uint32_t> queueValues = { families.graphicsFamily.value() };
+
+	if (families.presentFamily.has_value())
+		queueValues.insert(families.presentFamily.value());
+
+	if (families.transferFamily.has_value())
+		queueValues.insert(families.transferFamily.value());
+
+	if (families.computeFamily.has_value())
+		queueValues.insert(families.computeFamily.value());
+
 	std::vector<VkDeviceQueueCreateInfo> queues;
 	queues.reserve(queueValues.size());
 	
@@ -808,7 +1875,16 @@ void Application::pickLogicalDevice()
 		queues.emplace_back(queueInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	//for the gpu driven draws, a command per object in one call and the object in firstInstance
 	VkPhysicalDeviceFeatures features{};
+	features.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	features.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+	multiDrawIndirectEnabled = features.multiDrawIndirect == VK_TRUE;
+	drawIndirectFirstInstanceEnabled = features.drawIndirectFirstInstance == VK_TRUE;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -818,8 +1894,70 @@ void Application::pickLogicalDevice()
 	createInfo.pQueueCreateInfos = queues.data();
 	createInfo.queueCreateInfoCount = queues.size();
 
-	createInfo.enabledExtensionCount = deviceExtensions.size();
-	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+	std::vector<const char*> enabledExtensions = deviceExtensions;
+
+	if(physicalDeviceProperties2Enabled && isDeviceExtensionAvailable(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+	{
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		memoryBudgetEnabled = true;
+	}
+
+	createInfo.enabledExtensionCount = enabledExtensions.size();
+	createInfo.ppEnabledExtensionNames = enabledExtensions.data();
+
+	//timeline semaphores are core in 1.2, but the instance, the device and the feature all have to be there
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	//looked up like every 1.1 and 1.2 function, so the exe still starts on a 1.0 loader and falls back to fences
+	auto getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+	if(getPhysicalDeviceFeatures2 && instanceApiVersion >= VK_API_VERSION_1_2 && deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &vulkan12Features;
+
+		getPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+		VkPhysicalDeviceVulkan12Features supported = vulkan12Features;
+
+		//only ask for what is used
+		vulkan12Features = {};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		timelineSemaphoreEnabled = supported.timelineSemaphore == VK_TRUE;
+		vulkan12Features.timelineSemaphore = supported.timelineSemaphore;
+
+		//the bindless heap: runtime sized arrays indexed with anything, partially written, and written while bound
+		bindlessEnabled = supported.descriptorIndexing && supported.runtimeDescriptorArray && supported.descriptorBindingPartiallyBound
+			&& supported.descriptorBindingSampledImageUpdateAfterBind && supported.descriptorBindingStorageBufferUpdateAfterBind
+			&& supported.descriptorBindingUpdateUnusedWhilePending
+			&& supported.shaderSampledImageArrayNonUniformIndexing && supported.shaderStorageBufferArrayNonUniformIndexing;
+
+		if(bindlessEnabled)
+		{
+			vulkan12Features.descriptorIndexing = VK_TRUE;
+			vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+			vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+			vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+			vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+		}
+
+		//the gpu writes how many draws there are too
+		drawIndirectCountEnabled = supported.drawIndirectCount == VK_TRUE;
+		vulkan12Features.drawIndirectCount = supported.drawIndirectCount;
+
+		if (timelineSemaphoreEnabled || bindlessEnabled || drawIndirectCountEnabled)
+			createInfo.pNext = &vulkan12Features;
+	}
 
 	/*
 	 * We should reference the validations layer previously set in the instance
@@ -833,7 +1971,27 @@ void Application::pickLogicalDevice()
 	else
 	{
 		vkGetDeviceQueue(logicalDevice, families.graphicsFamily.value(), 0, &graphicsQueue);
-		vkGetDeviceQueue(logicalDevice, families.presentFamily.value(), 0, &presentQueue);
+
+		if (timelineSemaphoreEnabled && !graphicsTimeline.init(logicalDevice))
+			timelineSemaphoreEnabled = false;
+
+		std::cout << "Synchronizing the frames with " << (timelineSemaphoreEnabled ? "timeline semaphores" : "fences") << std::endl;
+
+		//headless has nothing to present, the queue is never used
+		if (families.presentFamily.has_value())
+			vkGetDeviceQueue(logicalDevice, families.presentFamily.value(), 0, &presentQueue);
+		else
+			presentQueue = VK_NULL_HANDLE;
+
+		if (families.transferFamily.has_value())
+			vkGetDeviceQueue(logicalDevice, families.transferFamily.value(), 0, &transferQueue);
+		else
+			transferQueue = graphicsQueue;
+
+		if (families.computeFamily.has_value())
+			vkGetDeviceQueue(logicalDevice, families.computeFamily.value(), 0, &computeQueue);
+		else
+			computeQueue = graphicsQueue;
 	}
 }
 
@@ -886,8 +2044,12 @@ VkExtent2D Application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabil
 bool Application::canDeviceSupportExtensions(VkPhysicalDevice device)
 {
 	FQueueFamily familiy = queryQueueFamilies(device);
-	FSwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 
+	//headless only needs a graphics queue, lavapipe and the like are fine
+	if (headless)
+		return familiy.isComplete() && checkDeviceExtensionSupport(device);
+
+	FSwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 	
 	return familiy.isComplete() && checkDeviceExtensionSupport(device)
 	&& (!swapChainSupport.presentModes.empty() && !swapChainSupport.formats.empty());
@@ -912,9 +2074,28 @@ bool Application::checkDeviceExtensionSupport(VkPhysicalDevice device)
 	return requiredExtensions.empty();
 }
 
+bool Application::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName)
+{
+	uint32_t extensionCount;
+
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+	for(const auto& extension : availableExtensions)
+	{
+		if (strcmp(extension.extensionName, extensionName) == 0)
+			return true;
+	}
+
+	return false;
+}
+
 Application::FQueueFamily Application::queryQueueFamilies(VkPhysicalDevice device)
 {
 	FQueueFamily queueFamily{};
+	queueFamily.needsPresent = !headless;
 
 	uint32_t familyQueueCount = 0;
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &familyQueueCount, nullptr);
@@ -922,6 +2103,27 @@ Application::FQueueFamily Application::queryQueueFamilies(VkPhysicalDevice devic
 	std::vector<VkQueueFamilyProperties> props(familyQueueCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(device, &familyQueueCount, props.data());
 
+	//a transfer only family is usually backed by the copy engines, so uploads run next to the rendering
+	for(uint32_t i = 0; i < props.size(); i++)
+	{
+		if((props[i].queueFlags & VK_QUEUE_TRANSFER_BIT)
+			&& !(props[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			queueFamily.transferFamily = i;
+			break;
+		}
+	}
+
+	//compute without graphics is the async compute engine, it runs next to the rasterization
+	for(uint32_t i = 0; i < props.size(); i++)
+	{
+		if((props[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			queueFamily.computeFamily = i;
+			break;
+		}
+	}
+
 	for(int i = 0; i < props.size(); i++)
 	{
 		if(props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
@@ -931,7 +2133,7 @@ Application::FQueueFamily Application::queryQueueFamilies(VkPhysicalDevice devic
 			if (queueFamily.isComplete())
 				break;
 		}
-		else
+		else if(!headless)
 		{
 			VkBool32 presentSupport = false;
 			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
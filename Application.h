@@ -1,9 +1,33 @@
 #pragma once
 #define GLFW_INCLUDE_VULKAN
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <vector>
 #include <GLFW/glfw3.h>
 
+#include "AsyncCompute.h"
+#include "BindlessHeap.h"
+#include "CommandRecorder.h"
+#include "CpuProfiler.h"
+#include "DeletionQueue.h"
+#include "DeviceSelection.h"
+#include "FileIO.h"
+#include "FrameContext.h"
+#include "GpuProfiler.h"
+#include "IndirectRenderer.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include "LayoutCache.h"
+#include "MemoryAllocator.h"
+#include "Mesh.h"
+#include "PipelineCache.h"
+#include "PipelineManager.h"
+#include "ShaderHotReload.h"
+#include "StagingRing.h"
+#include "TimelineSemaphore.h"
+
 class Application
 {
 public:
@@ -13,14 +37,53 @@ public:
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		//only set if the device has a transfer only family, the uploads fall back on the graphics queue otherwise
+		std::optional<uint32_t> transferFamily;
+		//same for a compute only family, the compute work goes to the graphics queue without it
+		std::optional<uint32_t> computeFamily;
+
+		//headless doesn't present, so any device with a graphics queue will do
+		bool needsPresent = true;
 
 		bool isComplete()
 		{
 			return graphicsFamily.has_value()
-			&& presentFamily.has_value();
+			&& (presentFamily.has_value() || !needsPresent);
 		}
 	};
 
+	//the uniform block of Shaders/vertex.vert in cdynamicUniformSet, std140
+	struct FDrawUniforms
+	{
+		glm::vec4 offset = glm::vec4(0.0f);
+		glm::vec4 tint = glm::vec4(1.0f);
+	};
+
+	//an indexed draw of the mesh
+	struct FDrawItem
+	{
+		uint32_t indexCount;
+		uint32_t instanceCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		uint32_t firstInstance;
+		//0 is the main pipeline, the others are pipelineVariants[pipeline - 1]
+		uint32_t pipeline = 0;
+		//written to the frame's transient buffer before the recording, equal neighbours share their offset
+		FDrawUniforms uniforms;
+	};
+
+	//synthetic workload of the benchmark runner
+	struct FBenchmarkScene
+	{
+		const char* name;
+		uint32_t drawCount;
+		//of the mesh every draw uses, 1 is the plain triangle
+		uint32_t triangleCount;
+		//the draws cycle through this many pipelines
+		uint32_t pipelineCount;
+	};
+
 	struct FSwapChainSupportDetails
 	{
 		VkSurfaceCapabilitiesKHR capabilities;
@@ -34,15 +97,22 @@ private:
 	int32_t height;
 	int32_t width;
 
+	//no window, surface nor swap chain, the frames go to offscreen images
+	bool headless;
+	//--device, can be null
+	const char* deviceSelector;
+
 	VkInstance instance;
 	VkPhysicalDevice physicalDevice;
 	VkDevice logicalDevice;
 
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue;
+	VkQueue computeQueue;
 
 	VkSurfaceKHR surface;
-	VkSwapchainKHR swapchain;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
 	
 	std::vector<VkLayerProperties> availableLayers;
 
@@ -51,24 +121,123 @@ private:
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
 	std::vector<VkFramebuffer> swapChainFramebuffers;
+	//the images of swapChainImages when headless
+	std::vector<FImage> offscreenImages;
 
 	VkRenderPass renderPass;
+	//the pipelines and their layout are owned by pipelineManager
 	VkPipelineLayout pipelineLayout;
 	VkPipeline pipeline;
+	//same state with another specialization constant, only used to benchmark pipeline switches
+	std::vector<VkPipeline> pipelineVariants;
+	uint32_t pipelineVariantCount = 0;
+	//Shaders/instanced.vert, null if it isn't compiled, not hot reloaded
+	VkPipeline instancedPipeline = VK_NULL_HANDLE;
+	//the same shaders reading the rows from the object buffer of indirectRenderer
+	VkPipeline indirectPipeline = VK_NULL_HANDLE;
+	//Shaders/objects.vert, reads the rows through the bindless heap instead of a vertex stream, null without the heap
+	VkPipeline bindlessIndirectPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout bindlessIndirectLayout = VK_NULL_HANDLE;
+
+	PipelineCache pipelineCache;
+	//pipelineLayout and the set layouts come from here, made from the reflection of the shaders
+	LayoutCache layoutCache;
+	PipelineManager pipelineManager;
+
+	//the watcher builds new pipelines when the shaders change, drawFrame swaps them in before recording
+	ShaderHotReload shaderHotReload;
+	//guards the reloaded pipelines, and the render pass, layout and variant count a build reads
+	std::mutex shaderReloadMutex;
+	VkPipeline reloadedPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout reloadedLayout = VK_NULL_HANDLE;
+	std::vector<VkPipeline> reloadedVariants;
+	//reloaded pipelines dropped before a frame picked them up, the watcher can't touch the deletion queue so the render thread retires them
+	std::vector<VkPipeline> discardedPipelines;
+
+	MemoryAllocator memoryAllocator;
+	StagingRing stagingRing;
+
+	GpuProfiler gpuProfiler;
+	//VK_EXT_memory_budget needs VK_KHR_get_physical_device_properties2 on the instance
+	bool physicalDeviceProperties2Enabled = false;
+	bool memoryBudgetEnabled = false;
+
+	//VK_API_VERSION_1_2 when the loader has it
+	uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+	//signals the number of each frame once the gpu is done with it
+	//without it (1.0, or a device without the feature) each frame context waits on its own fence
+	bool timelineSemaphoreEnabled = false;
+	TimelineSemaphore graphicsTimeline;
+	//the descriptor indexing features of 1.2, the graphics pipelines get the heap at cbindlessSet when they are there
+	bool bindlessEnabled = false;
+	BindlessHeap bindlessHeap;
+
+	//the gpu driven draws need drawIndirectFirstInstance to find their object, the others only make them cheaper
+	bool drawIndirectFirstInstanceEnabled = false;
+	bool multiDrawIndirectEnabled = false;
+	bool drawIndirectCountEnabled = false;
+
+	CommandRecorder commandRecorder;
 
-	VkCommandPool commandPool;
-	std::vector<VkCommandBuffer> commandBuffers;
+	AsyncFileLoader fileLoader;
 
-	std::vector<VkSemaphore> imageAvailableSemaphores;
-	std::vector<VkSemaphore> renderFinishedSemaphores;
+	AsyncCompute asyncCompute;
+	//recorded every frame when set, on the async compute queue unless computeOnGraphicsQueue
+	//the graphics submit of the frame waits on it before its vertex shaders
+	std::function<void(VkCommandBuffer)> computePass;
+	bool computeOnGraphicsQueue = false;
 
-	std::vector<VkFence> inFlightFences;
-	std::vector<VkFence> imagesInFlight; //used to wait for the image to be free to use
-	size_t currentFrame = 0;
+	//big draw lists are split between these threads, each one records secondary command buffers from its own pools
+	JobSystem jobSystem;
+	std::vector<CommandRecorder> workerRecorders;
+	std::vector<VkCommandBuffer> workerSecondaries;
+
+	FMesh mesh;
+	std::vector<FDrawItem> drawList;
+
+	//cdynamicUniformSet of pipelineLayout, null if the shaders don't declare it
+	VkDescriptorSetLayout drawUniformLayout = VK_NULL_HANDLE;
+	//written once per frame, the draws bind it at drawUniformOffsets[i]
+	VkDescriptorSet drawUniformSet = VK_NULL_HANDLE;
+	std::vector<uint32_t> drawUniformOffsets;
+
+	//fills the batches every frame when set, they are drawn after drawList
+	std::function<void(InstanceBatcher&)> instancePass;
+	InstanceBatcher instanceBatcher;
+
+	//culled and drawn by the gpu every frame, after the instances
+	IndirectRenderer indirectRenderer;
+	FBuffer gpuObjects;
+	//gpuObjects in the bindless heap, given to bindlessIndirectPipeline as a push constant
+	uint32_t gpuObjectsHandle = cinvalidBindlessHandle;
+	double lastRecordMs = 0.0;
+
+	std::chrono::high_resolution_clock::time_point lastPresentTime;
+	double lastPresentIntervalMs = 0.0;
+
+	//one per frame in flight, currentFrame is the one being recorded
+	std::vector<FrameContext> frames;
+	uint32_t framesInFlight;
+	uint32_t currentFrame = 0;
+
+	//the number of the frame that last used each swap chain image, indexed by image
+	std::vector<uint64_t> imagesInFlight;
+
+	double lastFrameLatencyMs = 0.0;
+
+	//frames submitted so far, and how many of them the gpu is known to be done with
+	uint64_t frameNumber = 0;
+	uint64_t completedFrames = 0;
+
+	//swap chains, views, framebuffers... that in flight frames may still be using
+	DeletionQueue deletionQueue;
+
+	uint32_t swapChainRecreations = 0;
 	
 
 	//used to check if extensions are available (for now the swapchain, to present stuff on the screen)
-	const std::vector<const char*> deviceExtensions = 
+	//emptied when headless
+	std::vector<const char*> deviceExtensions = 
 	{
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
@@ -77,34 +246,124 @@ public:
 	bool framebufferResized = false;
 	
 public:
-	Application(int32_t height, int32_t width, const char* windowName);
+	//deviceSelector picks the physical device by index or name, the best scored one otherwise
+	Application(int32_t height, int32_t width, const char* windowName, bool headless = false, const char* deviceSelector = nullptr);
 	Application(const Application& app) = delete;
 	Application(const Application&& app) = delete;
 	~Application();
 
 	void run();
+	//renders a fixed number of frames, the only way to run headless
+	void runFrames(uint32_t frameCount);
+	//resizes the window back and forth while rendering, to measure the hitch of recreating the swap chain
+	void runResizeStorm(uint32_t resizeCount);
+	//compares resetting a whole pool against resetting or reallocating each command buffer
+	void runCommandResetBenchmark();
+	//records drawCount draws per frame with more and more recording threads
+	void runRecordingBenchmark(uint32_t drawCount);
+
+	//cpu zones of every thread and the gpu passes of the last frames, in chrome's trace format
+	void exportTrace(const char* path);
+
+	//renders every synthetic scene for frameCount frames after a warm up, and writes the stats as json
+	void runBenchmark(uint32_t frameCount, const char* outputPath);
+
+	//measures the throughput and the latency with 1, 2 and 3 frames in flight
+	void runFramesInFlightBenchmark(uint32_t frameCount);
+	//the same particle simulation recorded before the rasterization on the graphics queue, then on the compute queue
+	//reports how much of the compute the timestamps show running next to the graphics work
+	void runAsyncComputeBenchmark(uint32_t frameCount, uint32_t particleCount);
+	//instanceCount copies of the mesh drawn one draw each, then as a single instanced batch
+	void runInstancingBenchmark(uint32_t frameCount, uint32_t instanceCount);
+	//more and more objects drawn one draw each by the cpu, then culled and drawn by the gpu
+	void runGpuDrivenBenchmark(uint32_t frameCount);
+	//loads the file through loadBufferAsync while rendering, to see how long it takes and what the frames pay for it
+	void runAsyncLoadBenchmark(const char* path);
+
+	//waits for the device, between 1 and 3
+	void setFramesInFlight(uint32_t count);
+
+	//0 records everything on the render thread
+	void setRecordingThreads(uint32_t threadCount);
+
+	//maps the file on the loader thread, then a later frame uploads it in a new device local buffer
+	//onUploaded runs on the render thread, the buffer is usable by the frame that follows
+	//it gets an empty FBuffer when the file can't be mapped or uploaded, the caller owns the buffer otherwise
+	void loadBufferAsync(const char* path, VkBufferUsageFlags usage, std::function<void(const FBuffer&)>&& onUploaded);
+
+	//replaces the objects the gpu draws with the mesh, uploaded with the next frame, empty to stop drawing them
+	bool setGpuObjects(const std::vector<FGpuObject>& objects);
 
-	static std::vector<char> readFile(const char* fileName);
 
 private:
 	void cleanSwapChain();
+	void cleanPipeline();
+	void retireSwapChain(VkSwapchainKHR oldSwapchain);
+	void retirePipeline();
 	
 	void createSurface();
 	void createSwapChain();
+	void createOffscreenTargets();
 	void createImageViews();
 	void createRenderPass();
 	void createGraphicsPipeline();
+	//the pipeline and its variants, the layout and the render pass have to exist
+	void createPipelines();
+	//from any thread, only reads the render pass, the format and the variant count
+	//registers the shaders again, so it picks up what changed on disk
+	bool buildPipelines(VkPipelineLayout& builtLayout, VkPipeline& builtPipeline, std::vector<VkPipeline>& builtVariants);
+	void startShaderHotReload();
+	void applyReloadedPipelines();
+	//drawUniformLayout from pipelineLayout, whenever it changes
+	void findDrawUniformLayout();
+	//shaderReloadMutex has to be held
+	void discardReloadedPipelines();
+	//takes the pipelines replaced by a reload or a new variant count out of the pipeline manager, with the discarded ones
+	//the ones still in use are kept, the others are destroyed once the frames in flight are done
+	//the render thread only, with shaderReloadMutex held
+	void retirePipelines(std::vector<VkPipeline> replaced);
+	void setPipelineVariants(uint32_t variantCount);
 	void createFrameBuffer();
 	void createCommandPool();
-	void createCommandBuffers();
-	void createSemaphores();
-	void createFences();
+	void createStagingRing();
+	void createGpuProfiler();
+	void createAsyncCompute();
+	void createMesh();
+	void createGridMesh(uint32_t triangleCount);
+	void uploadMesh(const std::vector<FVertex>& vertices, const std::vector<uint32_t>& indices);
+	void retireMesh();
+	void destroyMesh();
+	//creates a device local buffer and queues the upload of data in it, the copy happens with the next frame
+	bool uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, FBuffer& buffer,
+		VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VkAccessFlags dstAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+	//records the commands of the frame into the image imageIndex
+	void recordFrame(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void recordDrawsParallel(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	//on the render thread before the recording, the workers only read the offsets
+	void pushDrawUniforms(FrameContext& frame);
+	void recordDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end);
+	//the pipeline, heap, viewport and scissor every draw starts from, recordDraws and the instances set them
+	void recordDrawState(VkCommandBuffer commandBuffer);
+	//the draws of indirectRenderer, with the bindless pipeline when the objects are in the heap
+	void recordGpuDrivenDraws(VkCommandBuffer commandBuffer);
+	//the instances and the gpu driven draws, in a secondary command buffer of the render thread when the draws are recorded in parallel
+	VkCommandBuffer recordBatchesSecondary(const VkCommandBufferInheritanceInfo& inheritanceInfo);
+	void createRecordingThreads(uint32_t threadCount);
+	void destroyRecordingThreads();
+	void createFrameContexts();
+	void destroyFrameContexts();
 
 	void recreateSwapChain();
 
 	void drawFrame();
+	//blocks until the gpu is done with the frame numbered value (frame.submittedFrame), then updates completedFrames
+	void waitForFrame(uint64_t value);
+	//false once the window should close, always true headless
+	bool pollEvents();
+	//measures the present to present interval, or submit to submit when headless
+	void notePresent();
 	
-	VkShaderModule createShaderModule(const std::vector<char>& code);
+	VkShaderModule createShaderModule(const FSpirvView& code);
 	
 	void pickPhysicalDevice();
 	void pickLogicalDevice();
@@ -117,6 +376,7 @@ private:
 	
 	bool canDeviceSupportExtensions(VkPhysicalDevice device);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+	bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
 	FQueueFamily queryQueueFamilies(VkPhysicalDevice device);
 	FSwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 };
@@ -0,0 +1,791 @@
+#include "Application.h"
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+void Application::runResizeStorm(uint32_t resizeCount)
+{
+	constexpr uint32_t cframesBetweenResizes = 10;
+	constexpr int cresizeStep = 64;
+
+	if(headless)
+	{
+		std::cout << "The resize storm needs a window, it can't run headless" << std::endl;
+		return;
+	}
+
+	int baseWidth, baseHeight;
+	glfwGetWindowSize(window, &baseWidth, &baseHeight);
+
+	std::vector<double> steadyFrames;
+	std::vector<double> resizeFrames;
+
+	uint32_t frame = 0;
+	uint32_t resizes = 0;
+
+	while(resizes < resizeCount && !glfwWindowShouldClose(window))
+	{
+		if(frame % cframesBetweenResizes == cframesBetweenResizes - 1)
+		{
+			//going back and forth between two sizes so that every resize changes the extent
+			int step = (resizes % 2 == 0) ? cresizeStep : 0;
+			glfwSetWindowSize(window, baseWidth + step, baseHeight + step);
+			resizes++;
+		}
+
+		uint32_t recreationsBefore = swapChainRecreations;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		glfwPollEvents();
+		drawFrame();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+		if (swapChainRecreations != recreationsBefore)
+			resizeFrames.push_back(ms);
+		else
+			steadyFrames.push_back(ms);
+
+		frame++;
+	}
+
+	vkDeviceWaitIdle(logicalDevice);
+
+	FFrameStats steady = computeFrameStats(steadyFrames);
+	FFrameStats resized = computeFrameStats(resizeFrames);
+
+	std::cout << "Resize storm, " << resizes << " resizes" << std::endl;
+	printFrameStats("Steady frames", steady);
+	printFrameStats("Resize frames", resized);
+	std::cout << "Resize hitch: " << resized.median - steady.median << " ms (median), "
+		<< resized.max - steady.median << " ms (worst)" << std::endl;
+}
+
+void Application::runCommandResetBenchmark()
+{
+	constexpr uint32_t citerations = 30;
+	const uint32_t drawCounts[] = { 1000, 10000, 100000 };
+
+	enum class EStrategy { PoolReset, BufferReset, Reallocation };
+	const EStrategy strategies[] = { EStrategy::PoolReset, EStrategy::BufferReset, EStrategy::Reallocation };
+	const char* strategyNames[] = { "pool reset", "buffer reset", "reallocation" };
+
+	FQueueFamily queueFamilyIndices = queryQueueFamilies(physicalDevice);
+
+	//nothing recorded here is ever submitted, so the pools are never in use by the gpu
+	auto record = [this](VkCommandBuffer commandBuffer, uint32_t drawCount)
+	{
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = swapChainFramebuffers[0];
+		renderPassInfo.renderArea.extent = swapChainExtent;
+
+		VkClearValue clearColor = { 0, 0, 0, 1.0f };
+		renderPassInfo.clearValueCount = 1;
+		renderPassInfo.pClearValues = &clearColor;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+		VkViewport viewport{ 0.0f, 0.0f, (float)swapChainExtent.width, (float)swapChainExtent.height, 0.0f, 1.0f };
+		VkRect2D scissor{ { 0, 0 }, swapChainExtent };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+		for (uint32_t i = 0; i < drawCount; i++)
+		{
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+		vkEndCommandBuffer(commandBuffer);
+	};
+
+	for(uint32_t drawCount : drawCounts)
+	{
+		for(size_t s = 0; s < 3; s++)
+		{
+			EStrategy strategy = strategies[s];
+
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+			poolInfo.flags = strategy == EStrategy::BufferReset ? VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT : 0;
+
+			VkCommandPool pool;
+			if(vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+			{
+				std::cout << "Unable to create the benchmark command pool" << std::endl;
+				return;
+			}
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = pool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
+
+			std::vector<double> timings;
+			timings.reserve(citerations);
+
+			for(uint32_t i = 0; i < citerations; i++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+
+				switch (strategy)
+				{
+				case EStrategy::PoolReset:
+					vkResetCommandPool(logicalDevice, pool, 0);
+					break;
+				case EStrategy::BufferReset:
+					vkResetCommandBuffer(commandBuffer, 0);
+					break;
+				case EStrategy::Reallocation:
+					vkFreeCommandBuffers(logicalDevice, pool, 1, &commandBuffer);
+					vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
+					break;
+				}
+
+				record(commandBuffer, drawCount);
+
+				auto end = std::chrono::high_resolution_clock::now();
+				timings.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+			}
+
+			vkDestroyCommandPool(logicalDevice, pool, nullptr);
+
+			std::string label = std::to_string(drawCount) + " draws, " + strategyNames[s];
+			printFrameStats(label.c_str(), computeFrameStats(timings));
+		}
+	}
+}
+
+void Application::runRecordingBenchmark(uint32_t drawCount)
+{
+	constexpr uint32_t cwarmupFrames = 20;
+	constexpr uint32_t cmeasuredFrames = 200;
+
+	uint32_t previousThreads = jobSystem.getThreadCount();
+	std::vector<FDrawItem> previousDrawList = drawList;
+
+	drawList.assign(drawCount, { mesh.indexCount, 1, 0, 0, 0 });
+
+	//0 is the single threaded path, recording straight into the primary command buffer
+	std::vector<uint32_t> threadCounts = { 0 };
+	uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2)
+		threadCounts.push_back(threads);
+
+	threadCounts.push_back(hardwareThreads);
+
+	for(uint32_t threads : threadCounts)
+	{
+		setRecordingThreads(threads);
+
+		std::vector<double> timings;
+		timings.reserve(cmeasuredFrames);
+
+		for(uint32_t frame = 0; frame < cwarmupFrames + cmeasuredFrames && pollEvents(); frame++)
+		{
+			drawFrame();
+
+			if (frame >= cwarmupFrames)
+				timings.push_back(lastRecordMs);
+		}
+
+		std::string label = std::to_string(drawCount) + " draws, " + std::to_string(threads) + " recording threads";
+		printFrameStats(label.c_str(), computeFrameStats(timings));
+	}
+
+	drawList = previousDrawList;
+	setRecordingThreads(previousThreads);
+}
+
+void Application::runBenchmark(uint32_t frameCount, const char* outputPath)
+{
+	constexpr uint32_t cwarmupFrames = 60;
+
+	//each one scales a single axis from the plain triangle
+	const FBenchmarkScene scenes[] =
+	{
+		{ "triangle", 1, 1, 1 },
+		{ "draws-1k", 1000, 1, 1 },
+		{ "draws-10k", 10000, 1, 1 },
+		{ "draws-50k", 50000, 1, 1 },
+		{ "triangles-16k", 1, 16384, 1 },
+		{ "triangles-256k", 1, 262144, 1 },
+		{ "pipelines-16", 4096, 1, 16 },
+		{ "pipelines-64", 4096, 1, 64 }
+	};
+
+	std::ofstream file(outputPath, std::ios::trunc);
+
+	if(!file.is_open())
+	{
+		std::cout << "failed to open " << outputPath << " to write the benchmark results" << std::endl;
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	file << std::fixed << std::setprecision(4);
+	file << "{\"device\":\"" << properties.deviceName << "\",\"driverVersion\":" << properties.driverVersion
+		<< ",\"headless\":" << (headless ? "true" : "false") << ",\"width\":" << swapChainExtent.width
+		<< ",\"height\":" << swapChainExtent.height << ",\"warmupFrames\":" << cwarmupFrames
+		<< ",\"frames\":" << frameCount << ",\"scenes\":[";
+
+	std::vector<FDrawItem> previousDrawList = drawList;
+	bool firstScene = true;
+
+	for(const FBenchmarkScene& scene : scenes)
+	{
+		if(scene.triangleCount > 1 || mesh.indexCount != 3)
+		{
+			retireMesh();
+
+			if (scene.triangleCount > 1)
+				createGridMesh(scene.triangleCount);
+			else
+				createMesh();
+		}
+
+		if (pipelineVariantCount != scene.pipelineCount - 1)
+			setPipelineVariants(scene.pipelineCount - 1);
+
+		drawList.assign(scene.drawCount, { mesh.indexCount, 1, 0, 0, 0 });
+
+		for (uint32_t i = 0; i < scene.drawCount; i++)
+			drawList[i].pipeline = i % scene.pipelineCount;
+
+		std::vector<double> cpuTimes;
+		std::vector<double> gpuTimes;
+		std::vector<double> presentIntervals;
+
+		cpuTimes.reserve(frameCount);
+		gpuTimes.reserve(frameCount);
+		presentIntervals.reserve(frameCount);
+
+		uint64_t lastGpuFrame = UINT64_MAX;
+		uint64_t firstMeasuredFrame = frameNumber + cwarmupFrames;
+
+		for(uint32_t frame = 0; frame < cwarmupFrames + frameCount && pollEvents(); frame++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			drawFrame();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			if (frame < cwarmupFrames)
+				continue;
+
+			cpuTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+			presentIntervals.push_back(lastPresentIntervalMs);
+
+			//the gpu times come back a few frames late, only the measured frames are kept
+			const GpuProfiler::FFrameTimings* gpuFrame = gpuProfiler.getLatestFrame();
+
+			if(gpuFrame != nullptr && gpuFrame->frame != lastGpuFrame && gpuFrame->frame >= firstMeasuredFrame && !gpuFrame->passes.empty())
+			{
+				lastGpuFrame = gpuFrame->frame;
+				gpuTimes.push_back(gpuFrame->passes[0].durationMs);
+			}
+		}
+
+		FFrameStats cpuStats = computeFrameStats(cpuTimes);
+		FFrameStats gpuStats = computeFrameStats(gpuTimes);
+		FFrameStats presentStats = computeFrameStats(presentIntervals);
+
+		std::cout << "Scene " << scene.name << std::endl;
+		printFrameStats("  CPU frame", cpuStats);
+		printFrameStats("  GPU frame", gpuStats);
+		printFrameStats("  Present interval", presentStats);
+
+		file << (firstScene ? "" : ",") << "\n{\"name\":\"" << scene.name << "\",\"draws\":" << scene.drawCount
+			<< ",\"triangles\":" << mesh.indexCount / 3 << ",\"pipelines\":" << scene.pipelineCount << ",\"cpuFrameMs\":";
+		writeFrameStatsJson(file, cpuStats);
+		file << ",\"gpuFrameMs\":";
+		writeFrameStatsJson(file, gpuStats);
+		file << ",\"presentIntervalMs\":";
+		writeFrameStatsJson(file, presentStats);
+		file << "}";
+
+		firstScene = false;
+	}
+
+	file << "\n]}\n";
+
+	std::cout << "Benchmark results written to " << outputPath << std::endl;
+
+	//back to the regular triangle
+	retireMesh();
+	createMesh();
+	setPipelineVariants(0);
+	drawList = previousDrawList;
+}
+
+void Application::runFramesInFlightBenchmark(uint32_t frameCount)
+{
+	constexpr uint32_t cwarmupFrames = 30;
+
+	uint32_t previousFramesInFlight = framesInFlight;
+
+	for(uint32_t count = 1; count <= 3; count++)
+	{
+		setFramesInFlight(count);
+
+		std::vector<double> latencies;
+		latencies.reserve(frameCount);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		uint32_t measured = 0;
+
+		for(uint32_t frame = 0; frame < cwarmupFrames + frameCount && pollEvents(); frame++)
+		{
+			if (frame == cwarmupFrames)
+				start = std::chrono::high_resolution_clock::now();
+
+			drawFrame();
+
+			if(frame >= cwarmupFrames)
+			{
+				latencies.push_back(lastFrameLatencyMs);
+				measured++;
+			}
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+		std::string label = std::to_string(count) + " frames in flight, latency";
+		printFrameStats(label.c_str(), computeFrameStats(latencies));
+		std::cout << count << " frames in flight, throughput " << (ms > 0.0 ? measured * 1000.0 / ms : 0.0) << " fps" << std::endl;
+	}
+
+	setFramesInFlight(previousFramesInFlight);
+}
+
+void Application::runAsyncComputeBenchmark(uint32_t frameCount, uint32_t particleCount)
+{
+	constexpr uint32_t cwarmupFrames = 30;
+	constexpr uint32_t csimulationSteps = 64;
+	constexpr uint32_t cgridTriangles = 262144;
+	constexpr uint32_t cgridDraws = 16;
+
+	struct FParticlePush
+	{
+		uint32_t count;
+		uint32_t iterations;
+		float dt;
+	};
+
+	MappedFile shaderFile;
+	FSpirvView shaderCode = mapSpirv("Shaders/particles.spv", shaderFile);
+
+	if(!shaderCode.isValid())
+	{
+		std::cout << "Compile Shaders/particles.comp with compileShaders.bat to run the async compute benchmark" << std::endl;
+		return;
+	}
+
+	//never read back, what the particles hold doesn't matter so they are not even initialized
+	FBuffer particles;
+	if(memoryAllocator.createBuffer(EMemoryPool::StaticGeometry, particleCount * 32ull, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, particles) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the particle buffer" << std::endl;
+		return;
+	}
+
+	//the set and push constant layouts come from the shader
+	FShaderReflection reflection;
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	VkPipelineLayout computeLayout = VK_NULL_HANDLE;
+
+	if (reflectSpirv(shaderCode, reflection))
+		computeLayout = layoutCache.getPipelineLayout(mergeReflections({ &reflection }), &setLayouts);
+
+	if(computeLayout == VK_NULL_HANDLE || setLayouts.empty())
+	{
+		std::cout << "Unable to make the particle pipeline layout" << std::endl;
+		memoryAllocator.destroyBuffer(particles);
+		return;
+	}
+
+	//the set is allocated from the frame's descriptors, only the first dispatch of a frame writes it
+	FDescriptorWrites particleWrites;
+	particleWrites.writeBuffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, particles.buffer);
+
+	VkShaderModule shaderModule = createShaderModule(shaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = computeLayout;
+
+	VkPipeline computePipeline = VK_NULL_HANDLE;
+	if(vkCreateComputePipelines(logicalDevice, pipelineCache.getHandle(), 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS)
+		computePipeline = VK_NULL_HANDLE;
+
+	vkDestroyShaderModule(logicalDevice, shaderModule, nullptr);
+
+	if(computePipeline == VK_NULL_HANDLE)
+	{
+		std::cout << "Unable to create the particle pipeline" << std::endl;
+		memoryAllocator.destroyBuffer(particles);
+		return;
+	}
+
+	computePass = [&](VkCommandBuffer commandBuffer)
+	{
+		FParticlePush push{ particleCount, csimulationSteps, 0.001f };
+
+		//the last frame's dispatch wrote the same particles, submitted earlier on this queue
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+
+		VkDescriptorSet descriptorSet = frames[currentFrame].descriptors.getSet(setLayouts[0], particleWrites);
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout, 0, 1, &descriptorSet, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+		vkCmdDispatch(commandBuffer, (particleCount + 255) / 256, 1, 1);
+	};
+
+	//enough rasterization for the compute to hide behind
+	std::vector<FDrawItem> previousDrawList = drawList;
+	retireMesh();
+	createGridMesh(cgridTriangles);
+	drawList.assign(cgridDraws, { mesh.indexCount, 1, 0, 0, 0 });
+
+	for(uint32_t pass = 0; pass < 2; pass++)
+	{
+		computeOnGraphicsQueue = pass == 0;
+		const char* label = computeOnGraphicsQueue ? "graphics queue" : (asyncCompute.isDedicated() ? "async compute queue" : "separate submit on the graphics queue");
+
+		//the particles change queue family between the passes, nothing is in flight when they do
+		vkDeviceWaitIdle(logicalDevice);
+
+		uint64_t firstMeasuredFrame = frameNumber + cwarmupFrames;
+		auto start = std::chrono::high_resolution_clock::now();
+		uint32_t measured = 0;
+
+		for(uint32_t frame = 0; frame < cwarmupFrames + frameCount && pollEvents(); frame++)
+		{
+			if (frame == cwarmupFrames)
+				start = std::chrono::high_resolution_clock::now();
+
+			drawFrame();
+
+			if (frame >= cwarmupFrames)
+				measured++;
+		}
+
+		vkDeviceWaitIdle(logicalDevice);
+
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+		//one more frame of each slot to read back the last timestamps
+		for (uint32_t frame = 0; frame < framesInFlight && pollEvents(); frame++)
+			drawFrame();
+
+		std::vector<double> computeTimes;
+		std::vector<double> graphicsTimes;
+		double computeTotal = 0.0;
+		double overlapTotal = 0.0;
+
+		std::vector<GpuProfiler::FFrameTimings> graphicsFrames = gpuProfiler.getHistory();
+
+		for(const GpuProfiler::FFrameTimings& graphicsFrame : graphicsFrames)
+		{
+			if (graphicsFrame.frame < firstMeasuredFrame || graphicsFrame.passes.empty())
+				continue;
+
+			graphicsTimes.push_back(graphicsFrame.passes[0].durationMs);
+
+			for(const GpuProfiler::FPassTiming& passTiming : graphicsFrame.passes)
+			{
+				if (strcmp(passTiming.name, "compute") == 0)
+					computeTimes.push_back(passTiming.durationMs);
+			}
+		}
+
+		if(!computeOnGraphicsQueue)
+		{
+			//timestamps of two queues are only comparable on the same device clock, true on the desktop drivers
+			for(const GpuProfiler::FFrameTimings& computeFrame : asyncCompute.getProfiler().getHistory())
+			{
+				if (computeFrame.frame < firstMeasuredFrame || computeFrame.passes.empty())
+					continue;
+
+				const GpuProfiler::FPassTiming& computeTiming = computeFrame.passes[0];
+				double computeBegin = computeFrame.startMs + computeTiming.beginMs;
+				double computeEnd = computeBegin + computeTiming.durationMs;
+
+				computeTimes.push_back(computeTiming.durationMs);
+				computeTotal += computeTiming.durationMs;
+
+				//the graphics frames never overlap each other, so the intersections add up
+				for(const GpuProfiler::FFrameTimings& graphicsFrame : graphicsFrames)
+				{
+					if (graphicsFrame.passes.empty())
+						continue;
+
+					double graphicsBegin = graphicsFrame.startMs + graphicsFrame.passes[0].beginMs;
+					double graphicsEnd = graphicsBegin + graphicsFrame.passes[0].durationMs;
+
+					overlapTotal += std::max(0.0, std::min(computeEnd, graphicsEnd) - std::max(computeBegin, graphicsBegin));
+				}
+			}
+		}
+
+		std::string computeLabel = std::string("Compute on the ") + label;
+		std::string graphicsLabel = std::string("Graphics frame, compute on the ") + label;
+		printFrameStats(computeLabel.c_str(), computeFrameStats(computeTimes));
+		printFrameStats(graphicsLabel.c_str(), computeFrameStats(graphicsTimes));
+
+		std::cout << label << ", throughput " << (ms > 0.0 ? measured * 1000.0 / ms : 0.0) << " fps";
+
+		if (!computeOnGraphicsQueue)
+			std::cout << ", " << (computeTotal > 0.0 ? overlapTotal * 100.0 / computeTotal : 0.0) << "% of the compute overlapped the graphics work";
+
+		std::cout << std::endl;
+	}
+
+	vkDeviceWaitIdle(logicalDevice);
+
+	computePass = nullptr;
+	computeOnGraphicsQueue = false;
+
+	vkDestroyPipeline(logicalDevice, computePipeline, nullptr);
+	memoryAllocator.destroyBuffer(particles);
+
+	retireMesh();
+	createMesh();
+	drawList = previousDrawList;
+}
+
+void Application::runInstancingBenchmark(uint32_t frameCount, uint32_t instanceCount)
+{
+	constexpr uint32_t cwarmupFrames = 30;
+
+	if(instancedPipeline == VK_NULL_HANDLE)
+	{
+		std::cout << "Compile Shaders/instanced.vert with compileShaders.bat to run the instancing benchmark" << std::endl;
+		return;
+	}
+
+	//a grid filling the screen, computed once so the passes only measure the submission
+	std::vector<FInstance> instances(instanceCount);
+	uint32_t side = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount)))));
+	float cellSize = 2.0f / side;
+
+	for(uint32_t i = 0; i < instanceCount; i++)
+	{
+		glm::mat4 transform(cellSize);
+		transform[3] = glm::vec4(-1.0f + cellSize * (i % side + 0.5f), -1.0f + cellSize * (i / side + 0.5f), 0.0f, 1.0f);
+
+		instances[i] = FInstance::fromMatrix(transform);
+	}
+
+	std::vector<FDrawItem> previousDrawList = drawList;
+
+	for(uint32_t pass = 0; pass < 2; pass++)
+	{
+		bool instanced = pass == 1;
+
+		if(instanced)
+		{
+			drawList.clear();
+			instancePass = [&](InstanceBatcher& batcher)
+			{
+				for (const FInstance& instance : instances)
+					batcher.add(mesh, instancedPipeline, instance);
+			};
+		}
+		else
+		{
+			drawList.assign(instanceCount, { mesh.indexCount, 1, 0, 0, 0 });
+		}
+
+		std::vector<double> frameTimes;
+		std::vector<double> recordTimes;
+		frameTimes.reserve(frameCount);
+		recordTimes.reserve(frameCount);
+
+		for(uint32_t frame = 0; frame < cwarmupFrames + frameCount && pollEvents(); frame++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			drawFrame();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			if(frame >= cwarmupFrames)
+			{
+				frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+				recordTimes.push_back(lastRecordMs);
+			}
+		}
+
+		std::string label = std::to_string(instanceCount) + (instanced ? " instances in " + std::to_string(instanceBatcher.getBatchCount()) + " batch" : " individual draws");
+		printFrameStats((label + ", cpu frame").c_str(), computeFrameStats(frameTimes));
+		printFrameStats((label + ", recording").c_str(), computeFrameStats(recordTimes));
+	}
+
+	vkDeviceWaitIdle(logicalDevice);
+
+	instancePass = nullptr;
+	drawList = previousDrawList;
+}
+
+void Application::runGpuDrivenBenchmark(uint32_t frameCount)
+{
+	constexpr uint32_t cwarmupFrames = 30;
+	const uint32_t cobjectCounts[] = { 1024, 8192, 32768, 131072 };
+
+	if(!indirectRenderer.isValid() || indirectPipeline == VK_NULL_HANDLE)
+	{
+		std::cout << "Compile Shaders/cull.comp and Shaders/instanced.vert with compileShaders.bat to run the gpu driven benchmark"
+			<< " (the device needs drawIndirectFirstInstance too)" << std::endl;
+		return;
+	}
+
+	std::vector<FDrawItem> previousDrawList = drawList;
+
+	for(uint32_t objectCount : cobjectCounts)
+	{
+		if(objectCount > indirectRenderer.getMaxObjects())
+		{
+			std::cout << "Skipping " << objectCount << " objects, over the " << indirectRenderer.getMaxObjects() << " of the device" << std::endl;
+			continue;
+		}
+
+		//a grid twice as wide as the screen, so about a quarter of the objects survive the culling
+		std::vector<FGpuObject> objects(objectCount);
+		uint32_t side = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(objectCount)))));
+		float cellSize = 4.0f / side;
+
+		for(uint32_t i = 0; i < objectCount; i++)
+		{
+			glm::mat4 transform(cellSize);
+			transform[3] = glm::vec4(-2.0f + cellSize * (i % side + 0.5f), -2.0f + cellSize * (i / side + 0.5f), 0.0f, 1.0f);
+
+			FInstance instance = FInstance::fromMatrix(transform);
+			objects[i] = { { instance.rows[0], instance.rows[1], instance.rows[2] }, mesh.bounds };
+		}
+
+		for(uint32_t pass = 0; pass < 2; pass++)
+		{
+			bool gpuDriven = pass == 1;
+
+			if(gpuDriven)
+			{
+				drawList.clear();
+
+				if (!setGpuObjects(objects))
+					break;
+			}
+			else
+			{
+				//what the cpu would record without culling at all
+				drawList.assign(objectCount, { mesh.indexCount, 1, 0, 0, 0 });
+			}
+
+			std::vector<double> frameTimes;
+			std::vector<double> recordTimes;
+			frameTimes.reserve(frameCount);
+			recordTimes.reserve(frameCount);
+
+			for(uint32_t frame = 0; frame < cwarmupFrames + frameCount && pollEvents(); frame++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				drawFrame();
+				auto end = std::chrono::high_resolution_clock::now();
+
+				if(frame >= cwarmupFrames)
+				{
+					frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+					recordTimes.push_back(lastRecordMs);
+				}
+			}
+
+			std::string label = std::to_string(objectCount) + (gpuDriven ? " objects culled and drawn by the gpu" : " cpu draws");
+			printFrameStats((label + ", cpu frame").c_str(), computeFrameStats(frameTimes));
+			printFrameStats((label + ", recording").c_str(), computeFrameStats(recordTimes));
+		}
+
+		setGpuObjects({});
+	}
+
+	vkDeviceWaitIdle(logicalDevice);
+
+	drawList = previousDrawList;
+}
+
+void Application::runAsyncLoadBenchmark(const char* path)
+{
+	bool done = false;
+	FBuffer loaded;
+	std::vector<double> frameTimes;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	loadBufferAsync(path, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, [&done, &loaded](const FBuffer& buffer)
+	{
+		loaded = buffer;
+		done = true;
+	});
+
+	//the callback comes in a drawFrame whatever happens, even when the window is closing
+	while(!done)
+	{
+		pollEvents();
+
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		drawFrame();
+		auto frameEnd = std::chrono::high_resolution_clock::now();
+
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	if(loaded.buffer == VK_NULL_HANDLE)
+	{
+		std::cout << "Unable to load " << path << std::endl;
+		return;
+	}
+
+	std::cout << "Loaded " << loaded.size / 1024 << " KiB from " << path << " in " << std::chrono::duration<double, std::milli>(end - start).count()
+		<< " ms, " << frameTimes.size() << " frames rendered meanwhile" << std::endl;
+	printFrameStats("frames during the load", computeFrameStats(frameTimes));
+
+	vkDeviceWaitIdle(logicalDevice);
+	memoryAllocator.destroyBuffer(loaded);
+}
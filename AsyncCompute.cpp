@@ -0,0 +1,153 @@
+#include "AsyncCompute.h"
+
+#include <iostream>
+
+void AsyncCompute::init(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t family, bool dedicated,
+	uint32_t framesInFlight, bool useTimeline)
+{
+	this->device = device;
+	this->queue = queue;
+	this->family = family;
+	this->dedicated = dedicated;
+
+	recorder.init(device, family, framesInFlight);
+	profiler.init(device, physicalDevice, family, framesInFlight, 16);
+
+	if (useTimeline && !timeline.init(device))
+		std::cout << "Falling back to fences for the async compute" << std::endl;
+
+	slots.resize(framesInFlight);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for(FSlot& slot : slots)
+	{
+		if (timeline.isValid())
+			continue;
+
+		if(vkCreateFence(device, &fenceInfo, nullptr, &slot.fence) != VK_SUCCESS
+			|| vkCreateSemaphore(device, &semaphoreInfo, nullptr, &slot.semaphore) != VK_SUCCESS)
+		{
+			std::cout << "Unable to create the async compute's sync objects" << std::endl;
+		}
+	}
+
+	std::cout << "Compute work runs on " << (dedicated ? "a dedicated compute queue" : "the graphics queue") << std::endl;
+}
+
+void AsyncCompute::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+		return;
+
+	if (timeline.isValid())
+		timeline.wait(lastTimelineValue);
+
+	for(FSlot& slot : slots)
+	{
+		if (slot.submitted && slot.fence != VK_NULL_HANDLE)
+			vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+
+		if (slot.fence != VK_NULL_HANDLE)
+			vkDestroyFence(device, slot.fence, nullptr);
+		if (slot.semaphore != VK_NULL_HANDLE)
+			vkDestroySemaphore(device, slot.semaphore, nullptr);
+	}
+
+	slots.clear();
+	timeline.destroy();
+	profiler.destroy();
+	recorder.destroy();
+
+	device = VK_NULL_HANDLE;
+}
+
+void AsyncCompute::beginFrame(uint32_t frameIndex, uint64_t frameNumber)
+{
+	FSlot& slot = slots[frameIndex];
+
+	//never blocks when graphics waited on it, only compute nobody waited on can still run
+	if(slot.submitted)
+	{
+		if (timeline.isValid())
+			timeline.wait(slot.timelineValue);
+		else
+			vkWaitForFences(device, 1, &slot.fence, VK_TRUE, UINT64_MAX);
+
+		slot.submitted = false;
+	}
+
+	currentSlot = frameIndex;
+	commandBuffer = VK_NULL_HANDLE;
+
+	recorder.beginFrame(frameIndex);
+	profiler.beginFrame(frameIndex, frameNumber);
+}
+
+VkCommandBuffer AsyncCompute::getCommandBuffer()
+{
+	if(commandBuffer == VK_NULL_HANDLE)
+	{
+		commandBuffer = recorder.beginPrimary();
+		profiler.recordReset(commandBuffer);
+	}
+
+	return commandBuffer;
+}
+
+bool AsyncCompute::submit(FSubmitSync& graphicsSync, VkPipelineStageFlags graphicsWaitStage, FSubmitSync* computeSync)
+{
+	if (commandBuffer == VK_NULL_HANDLE)
+		return false;
+
+	if(vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		std::cout << "Unable to record the compute commands !" << std::endl;
+		commandBuffer = VK_NULL_HANDLE;
+		return false;
+	}
+
+	FSlot& slot = slots[currentSlot];
+
+	FSubmitSync localSync;
+	FSubmitSync& sync = computeSync ? *computeSync : localSync;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	if(timeline.isValid())
+	{
+		slot.timelineValue = ++lastTimelineValue;
+		sync.signalTimeline(timeline, slot.timelineValue);
+	}
+	else
+	{
+		sync.signal(slot.semaphore);
+		vkResetFences(device, 1, &slot.fence);
+	}
+
+	sync.apply(submitInfo);
+
+	commandBuffer = VK_NULL_HANDLE;
+
+	if(vkQueueSubmit(queue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+	{
+		std::cout << "Unable to submit the compute work" << std::endl;
+		return false;
+	}
+
+	slot.submitted = true;
+
+	if (timeline.isValid())
+		graphicsSync.waitTimeline(timeline, graphicsWaitStage, slot.timelineValue);
+	else
+		graphicsSync.wait(slot.semaphore, graphicsWaitStage);
+
+	return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "CommandRecorder.h"
+#include "GpuProfiler.h"
+#include "TimelineSemaphore.h"
+
+//records compute work in its own command buffer and submits it on the compute only queue
+//so that culling, simulation... run next to the rasterization instead of before it
+//the graphics submit that uses the results waits on it, through a timeline value on 1.2 or a binary semaphore otherwise
+//without a compute only family the work goes to the graphics queue, nothing overlaps but the code is the same
+class AsyncCompute
+{
+	struct FSlot
+	{
+		VkFence fence = VK_NULL_HANDLE;
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		uint64_t timelineValue = 0;
+		bool submitted = false;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t family = 0;
+	bool dedicated = false;
+
+	CommandRecorder recorder;
+	//the compute queue has its own timestamps, they are read back like the graphics ones
+	GpuProfiler profiler;
+
+	TimelineSemaphore timeline;
+	uint64_t lastTimelineValue = 0;
+
+	std::vector<FSlot> slots;
+	uint32_t currentSlot = 0;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+public:
+	//dedicated tells if queue is a compute only queue or the graphics one
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, VkQueue queue, uint32_t family, bool dedicated,
+		uint32_t framesInFlight, bool useTimeline);
+	void destroy();
+
+	//the graphics frame that waited on this slot's compute is done, so the compute is done too
+	void beginFrame(uint32_t frameIndex, uint64_t frameNumber);
+
+	//the frame's compute command buffer, begun on first use, valid until submit
+	VkCommandBuffer getCommandBuffer();
+	bool hasWork() const { return commandBuffer != VK_NULL_HANDLE; }
+
+	//submits what was recorded this frame and adds the wait to graphicsSync, at graphicsWaitStage
+	//computeSync can hold what the compute itself waits on, the graphics timeline of a previous frame...
+	//buffers written here and read by graphics need an ownership transfer or concurrent sharing when isDedicated()
+	bool submit(FSubmitSync& graphicsSync, VkPipelineStageFlags graphicsWaitStage, FSubmitSync* computeSync = nullptr);
+
+	bool isDedicated() const { return dedicated; }
+	uint32_t getFamily() const { return family; }
+	GpuProfiler& getProfiler() { return profiler; }
+};
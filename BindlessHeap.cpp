@@ -0,0 +1,240 @@
+#include "BindlessHeap.h"
+
+#include <algorithm>
+#include <iostream>
+
+constexpr VkDescriptorType cbindlessTypes[] =
+{
+	VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+	VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+	VK_DESCRIPTOR_TYPE_SAMPLER
+};
+
+void BindlessHeap::init(VkInstance instance, VkDevice device, VkPhysicalDevice physicalDevice, uint32_t maxImages, uint32_t maxBuffers, uint32_t maxSamplers)
+{
+	this->device = device;
+
+	//core since 1.1, a 1.0 loader doesn't export it
+	auto getPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2"));
+
+	if(getPhysicalDeviceProperties2 == nullptr)
+	{
+		std::cout << "No vkGetPhysicalDeviceProperties2, no bindless heap" << std::endl;
+		return;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &indexingProperties;
+
+	getPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+	//the set is visible to every stage, so the per stage limits apply to the whole array
+	slots[static_cast<uint32_t>(EBindlessBinding::SampledImages)].capacity = std::min(maxImages,
+		std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages));
+	slots[static_cast<uint32_t>(EBindlessBinding::StorageBuffers)].capacity = std::min(maxBuffers,
+		std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers));
+	slots[static_cast<uint32_t>(EBindlessBinding::Samplers)].capacity = std::min(maxSamplers,
+		std::min(indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers));
+
+	VkDescriptorSetLayoutBinding bindings[static_cast<uint32_t>(EBindlessBinding::Count)]{};
+	VkDescriptorBindingFlags bindingFlags[static_cast<uint32_t>(EBindlessBinding::Count)];
+	VkDescriptorPoolSize poolSizes[static_cast<uint32_t>(EBindlessBinding::Count)];
+
+	for(uint32_t i = 0; i < static_cast<uint32_t>(EBindlessBinding::Count); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = cbindlessTypes[i];
+		bindings[i].descriptorCount = slots[i].capacity;
+		bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+
+		//the unregistered slots are never written, and registering doesn't touch the slots the frames in flight read
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+			| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+		poolSizes[i] = { cbindlessTypes[i], slots[i].capacity };
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsInfo.bindingCount = static_cast<uint32_t>(EBindlessBinding::Count);
+	bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = static_cast<uint32_t>(EBindlessBinding::Count);
+	layoutInfo.pBindings = bindings;
+
+	if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the bindless set layout" << std::endl;
+		layout = VK_NULL_HANDLE;
+		return;
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(EBindlessBinding::Count);
+	poolInfo.pPoolSizes = poolSizes;
+
+	if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the bindless descriptor pool" << std::endl;
+		pool = VK_NULL_HANDLE;
+		return;
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	if(vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+	{
+		std::cout << "Unable to allocate the bindless descriptor set" << std::endl;
+		set = VK_NULL_HANDLE;
+		return;
+	}
+
+	std::cout << "Bindless heap of " << slots[0].capacity << " images, " << slots[1].capacity << " buffers and "
+		<< slots[2].capacity << " samplers" << std::endl;
+}
+
+bool BindlessHeap::matchesHeap(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	for(const VkDescriptorSetLayoutBinding& binding : bindings)
+	{
+		if (binding.binding >= static_cast<uint32_t>(EBindlessBinding::Count) || binding.descriptorType != cbindlessTypes[binding.binding])
+			return false;
+	}
+
+	return true;
+}
+
+void BindlessHeap::destroy()
+{
+	if (pool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+
+	if (layout != VK_NULL_HANDLE)
+		vkDestroyDescriptorSetLayout(device, layout, nullptr);
+
+	pool = VK_NULL_HANDLE;
+	layout = VK_NULL_HANDLE;
+	set = VK_NULL_HANDLE;
+
+	for(FSlots& binding : slots)
+	{
+		binding.next = 0;
+		binding.released.clear();
+	}
+}
+
+uint32_t BindlessHeap::registerImage(VkImageView view, VkImageLayout imageLayout)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t handle = allocateSlot(EBindlessBinding::SampledImages);
+
+	if (handle == cinvalidBindlessHandle)
+		return handle;
+
+	VkDescriptorImageInfo imageInfo{ VK_NULL_HANDLE, view, imageLayout };
+	write(EBindlessBinding::SampledImages, handle, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr);
+
+	return handle;
+}
+
+uint32_t BindlessHeap::registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t handle = allocateSlot(EBindlessBinding::StorageBuffers);
+
+	if (handle == cinvalidBindlessHandle)
+		return handle;
+
+	VkDescriptorBufferInfo bufferInfo{ buffer, offset, range };
+	write(EBindlessBinding::StorageBuffers, handle, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+
+	return handle;
+}
+
+uint32_t BindlessHeap::registerSampler(VkSampler sampler)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t handle = allocateSlot(EBindlessBinding::Samplers);
+
+	if (handle == cinvalidBindlessHandle)
+		return handle;
+
+	VkDescriptorImageInfo imageInfo{ sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED };
+	write(EBindlessBinding::Samplers, handle, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr);
+
+	return handle;
+}
+
+void BindlessHeap::release(EBindlessBinding binding, uint32_t handle)
+{
+	if (handle == cinvalidBindlessHandle)
+		return;
+
+	//the descriptor is left as it is, partially bound arrays don't care as long as no shader reads it
+	std::lock_guard<std::mutex> lock(mutex);
+	slots[static_cast<uint32_t>(binding)].released.push_back(handle);
+}
+
+void BindlessHeap::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, cbindlessSet, 1, &set, 0, nullptr);
+}
+
+uint32_t BindlessHeap::allocateSlot(EBindlessBinding binding)
+{
+	if (set == VK_NULL_HANDLE)
+		return cinvalidBindlessHandle;
+
+	FSlots& bindingSlots = slots[static_cast<uint32_t>(binding)];
+
+	if(!bindingSlots.released.empty())
+	{
+		uint32_t handle = bindingSlots.released.back();
+		bindingSlots.released.pop_back();
+		return handle;
+	}
+
+	if(bindingSlots.next == bindingSlots.capacity)
+	{
+		std::cout << "The bindless heap is full, " << bindingSlots.capacity << " descriptors of this kind are registered" << std::endl;
+		return cinvalidBindlessHandle;
+	}
+
+	return bindingSlots.next++;
+}
+
+void BindlessHeap::write(EBindlessBinding binding, uint32_t handle, VkDescriptorType type,
+	const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo)
+{
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = set;
+	descriptorWrite.dstBinding = static_cast<uint32_t>(binding);
+	descriptorWrite.dstArrayElement = handle;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.descriptorType = type;
+	descriptorWrite.pImageInfo = imageInfo;
+	descriptorWrite.pBufferInfo = bufferInfo;
+
+	//update after bind, the set can be bound in command buffers being recorded or executed
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
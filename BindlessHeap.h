@@ -0,0 +1,70 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <vector>
+
+//the set of the heap in every graphics pipeline layout, so binding it once per command buffer is enough
+constexpr uint32_t cbindlessSet = 0;
+constexpr uint32_t cinvalidBindlessHandle = UINT32_MAX;
+
+//bindings of the heap's set, Shaders/bindless.glsl declares the same ones
+enum class EBindlessBinding : uint32_t
+{
+	SampledImages = 0,
+	StorageBuffers = 1,
+	Samplers = 2,
+	Count
+};
+
+//every image, buffer and sampler the shaders can read, in one descriptor set with a big array of each
+//a resource is registered once and gets a handle, its index in the array, that the shaders get through push constants or per draw data
+//the arrays are partially bound and update after bind, so registering never waits for the frames using the set
+//needs the descriptor indexing features of 1.2
+class BindlessHeap
+{
+	struct FSlots
+	{
+		uint32_t capacity = 0;
+		//slots after it were never used
+		uint32_t next = 0;
+		std::vector<uint32_t> released;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+
+	FSlots slots[static_cast<uint32_t>(EBindlessBinding::Count)];
+
+	//resources can be registered from the loading threads, and the writes to the set have to be synchronized
+	std::mutex mutex;
+
+public:
+	//the sizes are clamped to what the device allows
+	void init(VkInstance instance, VkDevice device, VkPhysicalDevice physicalDevice, uint32_t maxImages, uint32_t maxBuffers, uint32_t maxSamplers);
+	void destroy();
+
+	//the handle stays the same until the resource is released, cinvalidBindlessHandle when the array is full
+	uint32_t registerImage(VkImageView view, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	uint32_t registerSampler(VkSampler sampler);
+
+	//no frame in flight may use the handle anymore (through the deletion queue...), it is given to the next registration
+	void release(EBindlessBinding binding, uint32_t handle);
+
+	//layout has to have the heap's layout at cbindlessSet
+	void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout) const;
+
+	//whether the bindings a shader declares in cbindlessSet are the heap's, same binding and type
+	static bool matchesHeap(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+
+	bool isValid() const { return set != VK_NULL_HANDLE; }
+	VkDescriptorSetLayout getLayout() const { return layout; }
+
+private:
+	//mutex has to be held for both
+	uint32_t allocateSlot(EBindlessBinding binding);
+	void write(EBindlessBinding binding, uint32_t handle, VkDescriptorType type, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+};
@@ -0,0 +1,93 @@
+#include "CommandRecorder.h"
+
+#include <iostream>
+
+void CommandRecorder::init(VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight)
+{
+	this->device = device;
+	frames.resize(framesInFlight);
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	//the buffers are re recorded every frame, and only ever reset through their pool
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	for(FFramePool& frame : frames)
+	{
+		if(vkCreateCommandPool(device, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+		{
+			std::cout << "Unable to create the command pool" << std::endl;
+		}
+	}
+}
+
+void CommandRecorder::destroy()
+{
+	//destroying the pool frees its command buffers
+	for(FFramePool& frame : frames)
+	{
+		vkDestroyCommandPool(device, frame.pool, nullptr);
+	}
+
+	frames.clear();
+}
+
+void CommandRecorder::beginFrame(uint32_t frameIndex)
+{
+	currentFrame = frameIndex;
+	FFramePool& frame = frames[currentFrame];
+
+	vkResetCommandPool(device, frame.pool, 0);
+
+	frame.usedPrimaries = 0;
+	frame.usedSecondaries = 0;
+}
+
+VkCommandBuffer CommandRecorder::beginPrimary()
+{
+	FFramePool& frame = frames[currentFrame];
+	VkCommandBuffer commandBuffer = acquire(frame.primaries, frame.usedPrimaries, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if(vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		std::cout << "Unable to begin recording the frame's command buffer" << std::endl;
+	}
+
+	return commandBuffer;
+}
+
+VkCommandBuffer CommandRecorder::allocateSecondary()
+{
+	FFramePool& frame = frames[currentFrame];
+
+	return acquire(frame.secondaries, frame.usedSecondaries, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+}
+
+VkCommandBuffer CommandRecorder::acquire(std::vector<VkCommandBuffer>& buffers, uint32_t& used, VkCommandBufferLevel level)
+{
+	if(used == buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = frames[currentFrame].pool;
+		allocInfo.level = level;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+
+		if(vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			std::cout << "Unable to allocate a command buffer" << std::endl;
+		}
+
+		buffers.push_back(commandBuffer);
+	}
+
+	return buffers[used++];
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+//one command pool per frame in flight, reset as a whole once the frame's fence signaled
+//the command buffers are kept between frames, so after warming up recording a frame allocates nothing
+class CommandRecorder
+{
+	struct FFramePool
+	{
+		VkCommandPool pool = VK_NULL_HANDLE;
+
+		std::vector<VkCommandBuffer> primaries;
+		std::vector<VkCommandBuffer> secondaries;
+
+		uint32_t usedPrimaries = 0;
+		uint32_t usedSecondaries = 0;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+
+	std::vector<FFramePool> frames;
+	uint32_t currentFrame = 0;
+
+public:
+	void init(VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight);
+	void destroy();
+
+	//the frame's fence has to be signaled, every buffer handed out for this frame becomes invalid
+	void beginFrame(uint32_t frameIndex);
+
+	//returns a primary command buffer in the recording state, valid until the next beginFrame of this frame
+	VkCommandBuffer beginPrimary();
+	//returns a secondary command buffer, not begun since it needs the inheritance info
+	VkCommandBuffer allocateSecondary();
+
+private:
+	VkCommandBuffer acquire(std::vector<VkCommandBuffer>& buffers, uint32_t& used, VkCommandBufferLevel level);
+};
@@ -0,0 +1,183 @@
+#include "CpuProfiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+//past this a thread drops its zones, a long capture shouldn't eat all the memory
+constexpr size_t cmaxEventsPerThread = 1 << 20;
+//more than the gpu profiler keeps, the older submits have no timings left to place
+constexpr size_t cframeSubmitHistory = 1024;
+
+namespace
+{
+	struct FEvent
+	{
+		const char* name;
+		int64_t beginNs;
+		int64_t endNs;
+	};
+
+	struct FThreadBuffer
+	{
+		uint32_t index;
+		std::string name;
+		std::vector<FEvent> events;
+	};
+
+	std::atomic<bool> enabled{ false };
+	const auto startTime = std::chrono::steady_clock::now();
+
+	//only locked the first time a thread records something
+	std::mutex registryMutex;
+	//owned here so the zones of a thread outlive it
+	std::vector<std::unique_ptr<FThreadBuffer>> threadBuffers;
+	thread_local FThreadBuffer* localBuffer = nullptr;
+
+	struct FFrameSubmit
+	{
+		uint64_t frame;
+		int64_t submitNs;
+	};
+
+	//indexed by frame number, a slot is overwritten once its frame is too old to be in the gpu history
+	FFrameSubmit frameSubmits[cframeSubmitHistory]{};
+
+	FThreadBuffer& getLocalBuffer()
+	{
+		if(localBuffer == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+
+			threadBuffers.push_back(std::make_unique<FThreadBuffer>());
+			localBuffer = threadBuffers.back().get();
+			localBuffer->index = static_cast<uint32_t>(threadBuffers.size() - 1);
+			localBuffer->name = "thread " + std::to_string(localBuffer->index);
+			localBuffer->events.reserve(4096);
+		}
+
+		return *localBuffer;
+	}
+
+	//the names come from the code, but a quote or a backslash in one would break the whole file
+	void writeJsonString(std::ostream& stream, const char* string)
+	{
+		stream << '"';
+
+		for(const char* c = string; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				stream << '\\' << *c;
+			else if (static_cast<unsigned char>(*c) < 0x20)
+				stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(*c) << std::dec << std::setfill(' ');
+			else
+				stream << *c;
+		}
+
+		stream << '"';
+	}
+}
+
+void CpuProfiler::setEnabled(bool enable)
+{
+	enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::isEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+int64_t CpuProfiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void CpuProfiler::record(const char* name, int64_t beginNs, int64_t endNs)
+{
+	FThreadBuffer& buffer = getLocalBuffer();
+
+	if (buffer.events.size() < cmaxEventsPerThread)
+		buffer.events.push_back({ name, beginNs, endNs });
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+	getLocalBuffer().name = name;
+}
+
+void CpuProfiler::markFrameSubmitted(uint64_t frame)
+{
+	if (isEnabled())
+		frameSubmits[frame % cframeSubmitHistory] = { frame, now() };
+}
+
+bool CpuProfiler::exportChromeTrace(const char* path, const std::vector<GpuProfiler::FFrameTimings>& gpuFrames)
+{
+	std::ofstream file(path, std::ios::trunc);
+
+	if(!file.is_open())
+	{
+		std::cout << "failed to open " << path << " to write the trace" << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(registryMutex);
+
+	//the timestamps are in microseconds, pid 0 is the cpu, pid 1 the gpu
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	size_t eventCount = 0;
+
+	for(const auto& buffer : threadBuffers)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->index << ",\"args\":{\"name\":";
+		writeJsonString(file, buffer->name.c_str());
+		file << "}}";
+
+		for(const FEvent& event : buffer->events)
+		{
+			file << ",\n{\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->index
+				<< ",\"ts\":" << event.beginNs / 1000.0 << ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << "}";
+		}
+
+		eventCount += buffer->events.size();
+	}
+
+	//there is no common clock between the cpu and the gpu in vulkan 1.0
+	//so a gpu frame starts at its submit, which is as early as it could have started
+	for(const GpuProfiler::FFrameTimings& frame : gpuFrames)
+	{
+		const FFrameSubmit& submit = frameSubmits[frame.frame % cframeSubmitHistory];
+
+		if (submit.frame != frame.frame || submit.submitNs == 0)
+			continue;
+
+		for(const GpuProfiler::FPassTiming& pass : frame.passes)
+		{
+			file << ",\n{\"name\":";
+			writeJsonString(file, pass.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":"
+				<< submit.submitNs / 1000.0 + pass.beginMs * 1000.0 << ",\"dur\":" << pass.durationMs * 1000.0
+				<< ",\"args\":{\"frame\":" << frame.frame << "}}";
+
+			eventCount++;
+		}
+	}
+
+	file << "\n]}\n";
+
+	std::cout << "Wrote " << eventCount << " trace events to " << path << std::endl;
+
+	return file.good();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "GpuProfiler.h"
+
+//records named cpu zones, each thread writes in its own buffer so recording takes no lock
+//the buffers are only read by the export, once the threads are idle
+class CpuProfiler
+{
+public:
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+	//nanoseconds since the profiler started
+	static int64_t now();
+
+	//name has to outlive the profiler, string literals only
+	static void record(const char* name, int64_t beginNs, int64_t endNs);
+	//shows up in the trace instead of the thread's index
+	static void setThreadName(const char* name);
+
+	//render thread only, the gpu timings of a frame are placed at its submit
+	static void markFrameSubmitted(uint64_t frame);
+
+	//writes the zones and the gpu passes in chrome's trace event format (chrome://tracing, perfetto)
+	static bool exportChromeTrace(const char* path, const std::vector<GpuProfiler::FFrameTimings>& gpuFrames);
+};
+
+//times its own lifetime
+class CpuScope
+{
+	const char* name;
+	int64_t begin;
+
+public:
+	explicit CpuScope(const char* name)
+		: name(name), begin(CpuProfiler::isEnabled() ? CpuProfiler::now() : -1)
+	{
+	}
+
+	~CpuScope()
+	{
+		if (begin >= 0)
+			CpuProfiler::record(name, begin, CpuProfiler::now());
+	}
+
+	CpuScope(const CpuScope&) = delete;
+	CpuScope& operator=(const CpuScope&) = delete;
+};
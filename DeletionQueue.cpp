@@ -0,0 +1,25 @@
+#include "DeletionQueue.h"
+
+void DeletionQueue::push(uint64_t frame, std::function<void()>&& destroy)
+{
+	entries.push_back({ frame, std::move(destroy) });
+}
+
+void DeletionQueue::flush(uint64_t completedFrames)
+{
+	//entries are pushed in frame order, so we can stop at the first one still in use
+	while(!entries.empty() && entries.front().frame <= completedFrames)
+	{
+		entries.front().destroy();
+		entries.pop_front();
+	}
+}
+
+void DeletionQueue::flushAll()
+{
+	while(!entries.empty())
+	{
+		entries.front().destroy();
+		entries.pop_front();
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+//holds on to vulkan objects that may still be used by frames in flight
+//an entry is destroyed once every frame submitted before it was retired is known to be done (its fence signaled)
+class DeletionQueue
+{
+	struct FEntry
+	{
+		uint64_t frame;
+		std::function<void()> destroy;
+	};
+
+	std::deque<FEntry> entries;
+
+public:
+	//frame is the number of frames submitted when the object got retired
+	void push(uint64_t frame, std::function<void()>&& destroy);
+
+	//completedFrames is the number of frames the gpu is done with
+	void flush(uint64_t completedFrames);
+	//only when the device is idle
+	void flushAll();
+
+	size_t size() const { return entries.size(); }
+};
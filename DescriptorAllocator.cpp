@@ -0,0 +1,251 @@
+#include "DescriptorAllocator.h"
+
+#include <functional>
+#include <iostream>
+
+constexpr uint32_t cdescriptorSetsPerPool = 256;
+
+//descriptors of each type a pool holds, for every set it can allocate
+//every type the reflection can give is there, a type missing from the pools fails on each of them
+constexpr struct
+{
+	VkDescriptorType type;
+	float ratio;
+} cdescriptorPoolRatios[] =
+{
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 0.5f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 0.5f }
+};
+
+static void hashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+FDescriptorWrites& FDescriptorWrites::writeBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	FWrite write{};
+	write.binding = binding;
+	write.type = type;
+	write.buffer = { buffer, offset, range };
+
+	writes.push_back(write);
+
+	return *this;
+}
+
+FDescriptorWrites& FDescriptorWrites::writeImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+	FWrite write{};
+	write.binding = binding;
+	write.type = type;
+	write.image = { sampler, view, layout };
+
+	writes.push_back(write);
+
+	return *this;
+}
+
+size_t FDescriptorWrites::hash() const
+{
+	size_t seed = writes.size();
+
+	for(const FWrite& write : writes)
+	{
+		hashCombine(seed, write.binding);
+		hashCombine(seed, write.type);
+		hashCombine(seed, std::hash<VkBuffer>()(write.buffer.buffer));
+		hashCombine(seed, std::hash<VkDeviceSize>()(write.buffer.offset));
+		hashCombine(seed, std::hash<VkDeviceSize>()(write.buffer.range));
+		hashCombine(seed, std::hash<VkImageView>()(write.image.imageView));
+		hashCombine(seed, std::hash<VkSampler>()(write.image.sampler));
+		hashCombine(seed, write.image.imageLayout);
+	}
+
+	return seed;
+}
+
+bool FDescriptorWrites::operator==(const FDescriptorWrites& other) const
+{
+	if (writes.size() != other.writes.size())
+		return false;
+
+	for(size_t i = 0; i < writes.size(); i++)
+	{
+		const FWrite& a = writes[i];
+		const FWrite& b = other.writes[i];
+
+		if (a.binding != b.binding || a.type != b.type
+			|| a.buffer.buffer != b.buffer.buffer || a.buffer.offset != b.buffer.offset || a.buffer.range != b.buffer.range
+			|| a.image.imageView != b.image.imageView || a.image.sampler != b.image.sampler || a.image.imageLayout != b.image.imageLayout)
+			return false;
+	}
+
+	return true;
+}
+
+void DescriptorAllocator::init(VkDevice device)
+{
+	this->device = device;
+}
+
+void DescriptorAllocator::destroy()
+{
+	reset();
+
+	for (VkDescriptorPool pool : freePools)
+		vkDestroyDescriptorPool(device, pool, nullptr);
+
+	freePools.clear();
+}
+
+void DescriptorAllocator::reset()
+{
+	if (currentPool != VK_NULL_HANDLE)
+		usedPools.push_back(currentPool);
+
+	currentPool = VK_NULL_HANDLE;
+
+	for(VkDescriptorPool pool : usedPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+		freePools.push_back(pool);
+	}
+
+	usedPools.clear();
+	cache.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+	if (currentPool == VK_NULL_HANDLE)
+		currentPool = grabPool();
+
+	if (currentPool == VK_NULL_HANDLE)
+		return VK_NULL_HANDLE;
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = currentPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult res = vkAllocateDescriptorSets(device, &allocInfo, &set);
+
+	//the pool is full, the next one gets the set
+	if(res == VK_ERROR_OUT_OF_POOL_MEMORY || res == VK_ERROR_FRAGMENTED_POOL)
+	{
+		usedPools.push_back(currentPool);
+		currentPool = grabPool();
+
+		if (currentPool == VK_NULL_HANDLE)
+			return VK_NULL_HANDLE;
+
+		allocInfo.descriptorPool = currentPool;
+		res = vkAllocateDescriptorSets(device, &allocInfo, &set);
+	}
+
+	if(res != VK_SUCCESS)
+	{
+		std::cout << "Unable to allocate a descriptor set" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	stats.allocated++;
+
+	return set;
+}
+
+VkDescriptorSet DescriptorAllocator::getSet(VkDescriptorSetLayout layout, const FDescriptorWrites& writes)
+{
+	size_t hash = writes.hash();
+	hashCombine(hash, std::hash<VkDescriptorSetLayout>()(layout));
+
+	auto range = cache.equal_range(hash);
+
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(it->second.layout == layout && it->second.writes == writes)
+		{
+			stats.reused++;
+			return it->second.set;
+		}
+	}
+
+	VkDescriptorSet set = allocate(layout);
+
+	if (set == VK_NULL_HANDLE)
+		return VK_NULL_HANDLE;
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites;
+	descriptorWrites.reserve(writes.writes.size());
+
+	for(const FDescriptorWrites::FWrite& write : writes.writes)
+	{
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = write.binding;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = write.type;
+
+		if (write.buffer.buffer != VK_NULL_HANDLE)
+			descriptorWrite.pBufferInfo = &write.buffer;
+		else
+			descriptorWrite.pImageInfo = &write.image;
+
+		descriptorWrites.push_back(descriptorWrite);
+	}
+
+	//one call for the whole set
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	cache.emplace(hash, FCachedSet{ layout, writes, set });
+
+	return set;
+}
+
+VkDescriptorPool DescriptorAllocator::grabPool()
+{
+	if(!freePools.empty())
+	{
+		VkDescriptorPool pool = freePools.back();
+		freePools.pop_back();
+		return pool;
+	}
+
+	VkDescriptorPoolSize poolSizes[sizeof(cdescriptorPoolRatios) / sizeof(cdescriptorPoolRatios[0])];
+	uint32_t sizeCount = 0;
+
+	for(const auto& ratio : cdescriptorPoolRatios)
+	{
+		poolSizes[sizeCount++] = { ratio.type, static_cast<uint32_t>(ratio.ratio * cdescriptorSetsPerPool) };
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = cdescriptorSetsPerPool;
+	poolInfo.poolSizeCount = sizeCount;
+	poolInfo.pPoolSizes = poolSizes;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+
+	if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create a descriptor pool" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	stats.poolsCreated++;
+
+	return pool;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <vector>
+
+//what a descriptor set points to, two equal lists of writes give the same set within a frame
+struct FDescriptorWrites
+{
+	struct FWrite
+	{
+		uint32_t binding;
+		VkDescriptorType type;
+		VkDescriptorBufferInfo buffer;
+		VkDescriptorImageInfo image;
+	};
+
+	std::vector<FWrite> writes;
+
+	FDescriptorWrites& writeBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	FDescriptorWrites& writeImage(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler,
+		VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	size_t hash() const;
+	bool operator==(const FDescriptorWrites& other) const;
+};
+
+//descriptor sets that only live for a frame, one of these per frame context
+//the sets come from a list of pools that grows when they are full and is reset as a whole when the frame comes around again
+//so nothing is ever freed one by one, and a set written the same way twice in a frame is only allocated and updated once
+//not thread safe, the sets of a frame are asked for by the thread building it
+class DescriptorAllocator
+{
+public:
+	struct FStats
+	{
+		uint32_t allocated = 0;
+		uint32_t reused = 0;
+		uint32_t poolsCreated = 0;
+	};
+
+private:
+	struct FCachedSet
+	{
+		VkDescriptorSetLayout layout;
+		FDescriptorWrites writes;
+		VkDescriptorSet set;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+
+	VkDescriptorPool currentPool = VK_NULL_HANDLE;
+	//full pools, reset with the frame
+	std::vector<VkDescriptorPool> usedPools;
+	//already reset, taken before creating a new one
+	std::vector<VkDescriptorPool> freePools;
+
+	std::unordered_multimap<size_t, FCachedSet> cache;
+
+	FStats stats;
+
+public:
+	void init(VkDevice device);
+	void destroy();
+
+	//the frame's fence has to be signaled, every set allocated since the last reset becomes invalid
+	void reset();
+
+	//a new set, to be written by the caller
+	VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+	//the set for layout written with writes, allocated and updated the first time the frame asks for it
+	VkDescriptorSet getSet(VkDescriptorSetLayout layout, const FDescriptorWrites& writes);
+
+	const FStats& getStats() const { return stats; }
+
+private:
+	VkDescriptorPool grabPool();
+};
@@ -0,0 +1,191 @@
+#include "DeviceSelection.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+//an order of magnitude apart, so a bigger heap or more queues never make an integrated gpu beat a discrete one
+static uint64_t scoreDeviceType(VkPhysicalDeviceType type)
+{
+	switch (type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return 10000000;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return 1000000;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return 100000;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		//lavapipe, swiftshader... only when there is nothing else
+		return 0;
+	default:
+		return 10000;
+	}
+}
+
+static const char* getDeviceTypeName(VkPhysicalDeviceType type)
+{
+	switch (type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+		return "discrete";
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+		return "integrated";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+		return "virtual";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU:
+		return "cpu";
+	default:
+		return "other";
+	}
+}
+
+FDeviceRanking rankPhysicalDevice(VkInstance instance, VkPhysicalDevice device, uint32_t index, uint32_t instanceApiVersion)
+{
+	FDeviceRanking ranking;
+	ranking.device = device;
+	ranking.index = index;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device, &properties);
+
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(device, &features);
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+
+	ranking.name = properties.deviceName;
+	ranking.type = properties.deviceType;
+	ranking.multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+
+	for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			ranking.deviceLocalBytes = std::max(ranking.deviceLocalBytes, memoryProperties.memoryHeaps[i].size);
+	}
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+	for(const VkQueueFamilyProperties& family : families)
+	{
+		bool graphics = family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+		bool compute = family.queueFlags & VK_QUEUE_COMPUTE_BIT;
+
+		if (compute && !graphics)
+			ranking.dedicatedCompute = true;
+
+		if ((family.queueFlags & VK_QUEUE_TRANSFER_BIT) && !graphics && !compute)
+			ranking.dedicatedTransfer = true;
+	}
+
+	auto getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+		vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2"));
+
+	if(getPhysicalDeviceFeatures2 && instanceApiVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2)
+	{
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &vulkan12Features;
+
+		getPhysicalDeviceFeatures2(device, &features2);
+
+		ranking.timelineSemaphore = vulkan12Features.timelineSemaphore == VK_TRUE;
+		ranking.descriptorIndexing = vulkan12Features.descriptorIndexing == VK_TRUE;
+	}
+
+	uint64_t score = scoreDeviceType(ranking.type);
+
+	//a point per MiB, up to 64 GiB so it stays under the gap between two types
+	score += std::min<uint64_t>(ranking.deviceLocalBytes / (1024 * 1024), 65536);
+
+	//uploads and compute overlap the graphics work only with their own families
+	if (ranking.dedicatedCompute)
+		score += 20000;
+	if (ranking.dedicatedTransfer)
+		score += 20000;
+
+	if (ranking.timelineSemaphore)
+		score += 10000;
+	if (ranking.descriptorIndexing)
+		score += 10000;
+	if (ranking.multiDrawIndirect)
+		score += 10000;
+
+	//bigger limits usually mean a bigger chip
+	score += properties.limits.maxImageDimension2D / 16;
+	score += properties.limits.maxComputeSharedMemorySize / 1024;
+
+	ranking.score = score;
+
+	return ranking;
+}
+
+void sortDeviceRankings(std::vector<FDeviceRanking>& rankings)
+{
+	std::stable_sort(rankings.begin(), rankings.end(), [](const FDeviceRanking& a, const FDeviceRanking& b)
+	{
+		if (a.suitable != b.suitable)
+			return a.suitable;
+
+		if (a.score != b.score)
+			return a.score > b.score;
+
+		return a.index < b.index;
+	});
+}
+
+int findDeviceBySelector(const std::vector<FDeviceRanking>& rankings, const char* selector)
+{
+	std::string wanted(selector);
+
+	if (wanted.empty())
+		return -1;
+
+	bool isIndex = std::all_of(wanted.begin(), wanted.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+
+	auto toLower = [](std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		return text;
+	};
+
+	std::string lowerWanted = toLower(wanted);
+	uint32_t wantedIndex = isIndex ? static_cast<uint32_t>(std::strtoul(selector, nullptr, 10)) : 0;
+
+	for(size_t i = 0; i < rankings.size(); i++)
+	{
+		if (isIndex && rankings[i].index == wantedIndex)
+			return static_cast<int>(i);
+
+		if (!isIndex && toLower(rankings[i].name).find(lowerWanted) != std::string::npos)
+			return static_cast<int>(i);
+	}
+
+	return -1;
+}
+
+void printDeviceRankings(const std::vector<FDeviceRanking>& rankings)
+{
+	std::cout << "Physical devices, best first" << std::endl;
+
+	for(const FDeviceRanking& ranking : rankings)
+	{
+		std::cout << "  [" << ranking.index << "] " << ranking.name << " (" << getDeviceTypeName(ranking.type) << ", "
+			<< ranking.deviceLocalBytes / (1024 * 1024) << " MiB)"
+			<< " score " << ranking.score
+			<< (ranking.dedicatedCompute ? ", dedicated compute" : "")
+			<< (ranking.dedicatedTransfer ? ", dedicated transfer" : "")
+			<< (ranking.timelineSemaphore ? ", timeline" : "")
+			<< (ranking.descriptorIndexing ? ", descriptor indexing" : "")
+			<< (ranking.suitable ? "" : ", not suitable") << std::endl;
+	}
+}
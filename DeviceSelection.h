@@ -0,0 +1,39 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+//what the selection knows about one physical device, and the score it got from it
+struct FDeviceRanking
+{
+	VkPhysicalDevice device = VK_NULL_HANDLE;
+	//in the order of vkEnumeratePhysicalDevices, what an override by index refers to
+	uint32_t index = 0;
+	std::string name;
+	VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+
+	//biggest device local heap
+	VkDeviceSize deviceLocalBytes = 0;
+	bool dedicatedCompute = false;
+	bool dedicatedTransfer = false;
+	bool timelineSemaphore = false;
+	bool descriptorIndexing = false;
+	bool multiDrawIndirect = false;
+
+	//filled by the application, a device missing a queue or an extension is never picked
+	bool suitable = false;
+	uint64_t score = 0;
+};
+
+//scores everything but the suitability, the device type always wins over the rest
+//instanceApiVersion decides if the 1.2 features can be queried
+FDeviceRanking rankPhysicalDevice(VkInstance instance, VkPhysicalDevice device, uint32_t index, uint32_t instanceApiVersion);
+
+//best suitable device first, ties go to the first enumerated so the choice doesn't change between runs
+void sortDeviceRankings(std::vector<FDeviceRanking>& rankings);
+
+//selector is an index ("1") or a part of the device name ("nvidia"), case insensitive
+//returns the position in rankings or -1
+int findDeviceBySelector(const std::vector<FDeviceRanking>& rankings, const char* selector);
+
+void printDeviceRankings(const std::vector<FDeviceRanking>& rankings);
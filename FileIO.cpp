@@ -0,0 +1,253 @@
+#include "FileIO.h"
+
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr uint32_t cspirvMagic = 0x07230203;
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	close();
+
+	view = other.view;
+	size = other.size;
+	file = other.file;
+#ifdef _WIN32
+	mapping = other.mapping;
+	other.file = nullptr;
+	other.mapping = nullptr;
+#else
+	other.file = -1;
+#endif
+	other.view = nullptr;
+	other.size = 0;
+
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const char* path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	file = handle;
+
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	size = static_cast<size_t>(fileSize.QuadPart);
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if(mapping == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	file = ::open(path, O_RDONLY);
+
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if(fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	size = static_cast<size_t>(status.st_size);
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	view = mapped == MAP_FAILED ? nullptr : mapped;
+#endif
+
+	if(view == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (view != nullptr)
+		UnmapViewOfFile(view);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != nullptr)
+		CloseHandle(file);
+
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (view != nullptr)
+		munmap(const_cast<void*>(view), size);
+	if (file >= 0)
+		::close(file);
+
+	file = -1;
+#endif
+
+	view = nullptr;
+	size = 0;
+}
+
+FSpirvView getSpirvView(const MappedFile& file)
+{
+	FSpirvView spirv;
+
+	if (!file.isOpen() || file.getSize() < sizeof(uint32_t) * 5 || file.getSize() % sizeof(uint32_t) != 0)
+		return spirv;
+
+	const uint32_t* words = static_cast<const uint32_t*>(file.getData());
+
+	if (words[0] != cspirvMagic)
+		return spirv;
+
+	spirv.code = words;
+	spirv.size = file.getSize();
+
+	return spirv;
+}
+
+FSpirvView mapSpirv(const char* path, MappedFile& file)
+{
+	if(!file.open(path))
+	{
+		std::cout << "failed to open " << path << std::endl;
+		return {};
+	}
+
+	FSpirvView spirv = getSpirvView(file);
+
+	if (!spirv.isValid())
+		std::cout << path << " is not spir-v" << std::endl;
+
+	return spirv;
+}
+
+void AsyncFileLoader::init()
+{
+	stopping = false;
+	loader = std::thread(&AsyncFileLoader::loaderLoop, this);
+}
+
+void AsyncFileLoader::destroy()
+{
+	if (!loader.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wakeCondition.notify_all();
+	loader.join();
+
+	pending.clear();
+	completed.clear();
+}
+
+void AsyncFileLoader::load(const char* path, std::function<void(MappedFile&)>&& onLoaded)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back({ path, std::move(onLoaded), MappedFile() });
+	}
+
+	wakeCondition.notify_one();
+}
+
+uint32_t AsyncFileLoader::dispatchCompleted()
+{
+	std::deque<FRequest> done;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		done.swap(completed);
+	}
+
+	//outside of the lock, a callback can queue another load
+	for(FRequest& request : done)
+	{
+		request.onLoaded(request.file);
+	}
+
+	return static_cast<uint32_t>(done.size());
+}
+
+void AsyncFileLoader::loaderLoop()
+{
+	while(true)
+	{
+		FRequest request;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [this]() { return stopping || !pending.empty(); });
+
+			if (stopping)
+				return;
+
+			request = std::move(pending.front());
+			pending.pop_front();
+		}
+
+		if(request.file.open(request.path.c_str()))
+		{
+			//a read per page, the page faults (and the disk reads) happen here instead of during the copy
+			const volatile char* bytes = static_cast<const char*>(request.file.getData());
+			char sum = 0;
+
+			for (size_t offset = 0; offset < request.file.getSize(); offset += 4096)
+				sum += bytes[offset];
+
+			(void)sum;
+		}
+		else
+			std::cout << "failed to map " << request.path << std::endl;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		completed.push_back(std::move(request));
+	}
+}
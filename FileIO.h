@@ -0,0 +1,88 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//a read only view of a whole file, mapped in memory instead of read
+//the bytes come straight from the page cache, nothing is copied until someone copies them (in the staging ring...)
+class MappedFile
+{
+	const void* view = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int file = -1;
+#endif
+
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	~MappedFile();
+
+	//false if the file can't be opened or is empty
+	bool open(const char* path);
+	void close();
+
+	bool isOpen() const { return view != nullptr; }
+	const void* getData() const { return view; }
+	size_t getSize() const { return size; }
+};
+
+//spir-v words of a mapped file, the mapping starts on a page so the words are always aligned
+struct FSpirvView
+{
+	const uint32_t* code = nullptr;
+	//in bytes, as vkCreateShaderModule wants it
+	size_t size = 0;
+
+	bool isValid() const { return code != nullptr; }
+};
+
+//checks the size and the magic number, returns an invalid view if it's not spir-v
+FSpirvView getSpirvView(const MappedFile& file);
+//maps path in file and returns its spir-v, says why when it can't
+FSpirvView mapSpirv(const char* path, MappedFile& file);
+
+//maps files on its own thread and touches their pages there, so the disk reads don't happen on the caller
+//the completions are run by dispatchCompleted, on the thread that calls it, the render thread can upload from them then
+class AsyncFileLoader
+{
+	struct FRequest
+	{
+		std::string path;
+		std::function<void(MappedFile&)> onLoaded;
+		MappedFile file;
+	};
+
+	std::thread loader;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	bool stopping = false;
+
+	std::deque<FRequest> pending;
+	std::deque<FRequest> completed;
+
+public:
+	void init();
+	//the requests not done yet are dropped
+	void destroy();
+
+	//onLoaded gets a closed file if it couldn't be mapped
+	void load(const char* path, std::function<void(MappedFile&)>&& onLoaded);
+	//runs the callbacks of the loads done so far, returns how many
+	uint32_t dispatchCompleted();
+
+private:
+	void loaderLoop();
+};
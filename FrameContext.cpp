@@ -0,0 +1,94 @@
+#include "FrameContext.h"
+
+#include <iostream>
+
+void FrameContext::init(VkDevice device, MemoryAllocator& allocator, VkDeviceSize transientSize, const VkPhysicalDeviceLimits& limits)
+{
+	this->device = device;
+	this->allocator = &allocator;
+
+	uniformAlignment = limits.minUniformBufferOffsetAlignment;
+	storageAlignment = limits.minStorageBufferOffsetAlignment;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailable) != VK_SUCCESS
+		|| vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinished) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the semaphores" << std::endl;
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	//signaled, otherwise the first wait on it would never return
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	if (vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create fence !" << std::endl;
+	}
+
+	descriptors.init(device);
+
+	if(allocator.createBuffer(EMemoryPool::FrameDynamic, transientSize,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+		| VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, transientBuffer) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the frame's transient buffer" << std::endl;
+	}
+}
+
+void FrameContext::destroy()
+{
+	vkDestroySemaphore(device, imageAvailable, nullptr);
+	vkDestroySemaphore(device, renderFinished, nullptr);
+	vkDestroyFence(device, inFlightFence, nullptr);
+	descriptors.destroy();
+
+	allocator->destroyBuffer(transientBuffer);
+
+	imageAvailable = VK_NULL_HANDLE;
+	renderFinished = VK_NULL_HANDLE;
+	inFlightFence = VK_NULL_HANDLE;
+}
+
+void FrameContext::reset()
+{
+	descriptors.reset();
+	transientOffset = 0;
+}
+
+bool FrameContext::allocateTransient(VkDeviceSize size, VkDeviceSize alignment, FTransientAllocation& allocation)
+{
+	VkDeviceSize offset = (transientOffset + alignment - 1) / alignment * alignment;
+
+	if (transientBuffer.mapped == nullptr || offset + size > transientBuffer.size)
+		return false;
+
+	transientOffset = offset + size;
+
+	allocation.buffer = transientBuffer.buffer;
+	allocation.offset = offset;
+	allocation.mapped = static_cast<char*>(transientBuffer.mapped) + offset;
+
+	return true;
+}
+
+bool FrameContext::allocateUniform(VkDeviceSize size, FTransientAllocation& allocation)
+{
+	return allocateTransient(size, uniformAlignment, allocation);
+}
+
+bool FrameContext::allocateStorage(VkDeviceSize size, FTransientAllocation& allocation)
+{
+	return allocateTransient(size, storageAlignment, allocation);
+}
+
+void FrameContext::flushTransient()
+{
+	if (transientOffset == 0)
+		return;
+
+	vmaFlushAllocation(allocator->getHandle(), transientBuffer.allocation, 0, transientOffset);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstring>
+
+#include "DescriptorAllocator.h"
+#include "MemoryAllocator.h"
+
+//a chunk of the frame's transient buffer, valid until the frame context comes around again
+struct FTransientAllocation
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	//the dynamic offset to bind it at, the descriptor of the transient buffer is written at offset 0
+	VkDeviceSize offset = 0;
+	void* mapped = nullptr;
+};
+
+//everything a frame in flight owns, the frames go through a ring of these
+//the command pools, query pools and staging batches of the other systems are indexed the same way
+class FrameContext
+{
+public:
+	//only waited on without timeline semaphores, the graphics timeline tracks submittedFrame otherwise
+	VkFence inFlightFence = VK_NULL_HANDLE;
+	VkSemaphore imageAvailable = VK_NULL_HANDLE;
+	VkSemaphore renderFinished = VK_NULL_HANDLE;
+
+	//the descriptor sets of the frame, reset as a whole when the frame starts again
+	DescriptorAllocator descriptors;
+
+	//number of frames submitted once this one was
+	uint64_t submittedFrame = 0;
+	//when the cpu started working on the frame, for the latency
+	std::chrono::high_resolution_clock::time_point cpuStart;
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+
+	FBuffer transientBuffer;
+	VkDeviceSize transientOffset = 0;
+
+	//from the device limits, what the dynamic offsets have to be multiples of
+	VkDeviceSize uniformAlignment = 256;
+	VkDeviceSize storageAlignment = 256;
+
+public:
+	void init(VkDevice device, MemoryAllocator& allocator, VkDeviceSize transientSize, const VkPhysicalDeviceLimits& limits);
+	void destroy();
+
+	//the fence has to be signaled, what the previous use of this context allocated is reused
+	void reset();
+
+	//linear allocation in host visible memory, nothing to free
+	bool allocateTransient(VkDeviceSize size, VkDeviceSize alignment, FTransientAllocation& allocation);
+	//aligned to be bound with a dynamic offset, through a UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC descriptor of the transient buffer
+	bool allocateUniform(VkDeviceSize size, FTransientAllocation& allocation);
+	bool allocateStorage(VkDeviceSize size, FTransientAllocation& allocation);
+
+	//writes data for a draw and gives its dynamic offset, false once the frame's buffer is full
+	//the shaders read it from a uniform block in cdynamicUniformSet, which the layout cache makes dynamic
+	template<typename T>
+	bool pushUniform(const T& data, uint32_t& dynamicOffset)
+	{
+		FTransientAllocation allocation;
+
+		if (!allocateUniform(sizeof(T), allocation))
+			return false;
+
+		memcpy(allocation.mapped, &data, sizeof(T));
+		dynamicOffset = static_cast<uint32_t>(allocation.offset);
+
+		return true;
+	}
+
+	//what was written this frame, before the submit, the memory may not be coherent
+	void flushTransient();
+
+	//what the dynamic descriptors point to, their range has to be sizeof(T) and not VK_WHOLE_SIZE
+	//the whole buffer is over maxUniformBufferRange on most devices
+	VkBuffer getTransientBuffer() const { return transientBuffer.buffer; }
+};
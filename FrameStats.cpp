@@ -0,0 +1,60 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//nearest rank on an already sorted series
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+	rank = std::max<size_t>(rank, 1);
+
+	return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+FFrameStats computeFrameStats(std::vector<double> samples)
+{
+	FFrameStats stats{};
+
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+
+	stats.count = samples.size();
+	stats.min = samples.front();
+	stats.max = samples.back();
+
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+
+	stats.mean = sum / samples.size();
+
+	double variance = 0.0;
+	for (double sample : samples)
+		variance += (sample - stats.mean) * (sample - stats.mean);
+
+	stats.stddev = std::sqrt(variance / samples.size());
+
+	stats.median = percentile(samples, 0.5);
+	stats.p95 = percentile(samples, 0.95);
+	stats.p99 = percentile(samples, 0.99);
+
+	return stats;
+}
+
+void printFrameStats(const char* label, const FFrameStats& stats)
+{
+	std::cout << label << ": " << stats.count << " samples, mean " << stats.mean << " ms, median " << stats.median
+		<< " ms, p95 " << stats.p95 << " ms, p99 " << stats.p99 << " ms, max " << stats.max
+		<< " ms, stddev " << stats.stddev << " ms" << std::endl;
+}
+
+void writeFrameStatsJson(std::ostream& out, const FFrameStats& stats)
+{
+	out << "{\"count\":" << stats.count << ",\"mean\":" << stats.mean << ",\"median\":" << stats.median
+		<< ",\"p95\":" << stats.p95 << ",\"p99\":" << stats.p99 << ",\"min\":" << stats.min
+		<< ",\"max\":" << stats.max << ",\"stddev\":" << stats.stddev << "}";
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+//summary of a series of timings, in milliseconds
+struct FFrameStats
+{
+	size_t count = 0;
+	double mean = 0.0;
+	double median = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	double stddev = 0.0;
+};
+
+FFrameStats computeFrameStats(std::vector<double> samples);
+void printFrameStats(const char* label, const FFrameStats& stats);
+//as a json object, to be compared between runs by a script
+void writeFrameStatsJson(std::ostream& out, const FFrameStats& stats);
@@ -0,0 +1,217 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+
+constexpr uint32_t cinvalidScope = UINT32_MAX;
+
+void GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+	uint32_t maxScopes, uint32_t historyFrames)
+{
+	this->device = device;
+	this->maxScopes = maxScopes;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	uint32_t validBits = families[queueFamilyIndex].timestampValidBits;
+
+	if(validBits == 0)
+	{
+		std::cout << "The queue family " << queueFamilyIndex << " doesn't support timestamps, its gpu profiler is disabled" << std::endl;
+		return;
+	}
+
+	//nanoseconds per tick
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = maxScopes * 2;
+
+	frames.resize(framesInFlight);
+
+	for(FFrameQueries& frame : frames)
+	{
+		if(vkCreateQueryPool(device, &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+		{
+			std::cout << "Unable to create the timestamp query pool" << std::endl;
+			destroy();
+			return;
+		}
+
+		frame.scopes.resize(maxScopes);
+	}
+
+	history.resize(historyFrames);
+	results.resize(maxScopes * 2);
+
+	enabled = true;
+}
+
+void GpuProfiler::destroy()
+{
+	for(FFrameQueries& frame : frames)
+	{
+		if (frame.pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(device, frame.pool, nullptr);
+	}
+
+	frames.clear();
+	enabled = false;
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex, uint64_t frameNumber)
+{
+	if (!enabled)
+		return;
+
+	//the scopes of the previous frame are all recorded by now
+	frames[currentFrame].usedScopes = std::min(scopeCount.load(), maxScopes);
+
+	FFrameQueries& frame = frames[frameIndex];
+
+	if (frame.pending)
+		collect(frame);
+
+	currentFrame = frameIndex;
+	frame.frame = frameNumber;
+	scopeCount = 0;
+}
+
+void GpuProfiler::recordReset(VkCommandBuffer commandBuffer)
+{
+	if (!enabled)
+		return;
+
+	FFrameQueries& frame = frames[currentFrame];
+
+	vkCmdResetQueryPool(commandBuffer, frame.pool, 0, maxScopes * 2);
+	frame.pending = true;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+	if (!enabled)
+		return cinvalidScope;
+
+	uint32_t scope = scopeCount.fetch_add(1);
+
+	//out of queries, the scope is dropped rather than growing the pool mid frame
+	if (scope >= maxScopes)
+		return cinvalidScope;
+
+	FFrameQueries& frame = frames[currentFrame];
+	frame.scopes[scope] = { name, scope * 2 };
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, scope * 2);
+
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+	if (scope == cinvalidScope)
+		return;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames[currentFrame].pool, scope * 2 + 1);
+}
+
+std::vector<GpuProfiler::FFrameTimings> GpuProfiler::getHistory() const
+{
+	std::vector<FFrameTimings> ordered;
+	ordered.reserve(historySize);
+
+	size_t oldest = (historyHead + history.size() - historySize) % (history.empty() ? 1 : history.size());
+
+	for(size_t i = 0; i < historySize; i++)
+	{
+		ordered.push_back(history[(oldest + i) % history.size()]);
+	}
+
+	return ordered;
+}
+
+const GpuProfiler::FFrameTimings* GpuProfiler::getLatestFrame() const
+{
+	if (historySize == 0)
+		return nullptr;
+
+	return &history[(historyHead + history.size() - 1) % history.size()];
+}
+
+void GpuProfiler::printAverages() const
+{
+	if (historySize == 0)
+		return;
+
+	//sorted by name so the output is stable between runs
+	std::map<std::string, std::pair<double, uint32_t>> totals;
+
+	for(const FFrameTimings& frame : getHistory())
+	{
+		for(const FPassTiming& pass : frame.passes)
+		{
+			auto& total = totals[pass.name];
+			total.first += pass.durationMs;
+			total.second++;
+		}
+	}
+
+	std::cout << "GPU passes over the last " << historySize << " frames" << std::endl;
+
+	for(const auto& total : totals)
+	{
+		std::cout << "  " << total.first << ": " << total.second.first / total.second.second << " ms" << std::endl;
+	}
+}
+
+void GpuProfiler::collect(FFrameQueries& frame)
+{
+	frame.pending = false;
+
+	uint32_t usedScopes = frame.usedScopes;
+
+	if (usedScopes == 0)
+		return;
+
+	//no wait flag, the fence already signaled, if the results are somehow not there the frame is just skipped
+	VkResult res = vkGetQueryPoolResults(device, frame.pool, 0, usedScopes * 2, usedScopes * 2 * sizeof(uint64_t),
+		results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (res != VK_SUCCESS)
+		return;
+
+	FFrameTimings& timings = history[historyHead];
+	timings.frame = frame.frame;
+	timings.passes.clear();
+
+	uint64_t frameBegin = results[0] & timestampMask;
+	timings.startMs = frameBegin * timestampPeriod / 1e6;
+
+	for(uint32_t i = 0; i < usedScopes; i++)
+	{
+		uint64_t begin = results[i * 2] & timestampMask;
+		uint64_t end = results[i * 2 + 1] & timestampMask;
+
+		FPassTiming pass{};
+		pass.name = frame.scopes[i].name;
+		pass.beginMs = (begin - frameBegin) * timestampPeriod / 1e6;
+		pass.durationMs = (end - begin) * timestampPeriod / 1e6;
+
+		timings.passes.push_back(pass);
+	}
+
+	historyHead = (historyHead + 1) % history.size();
+	historySize = std::min(historySize + 1, history.size());
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <vector>
+
+//times passes on the gpu with timestamp queries, one query pool per frame in flight
+//a frame's results are read back once its fence signaled, so reading them never stalls
+class GpuProfiler
+{
+public:
+	struct FPassTiming
+	{
+		const char* name;
+		//from the first timestamp of the frame
+		double beginMs;
+		double durationMs;
+	};
+
+	struct FFrameTimings
+	{
+		uint64_t frame = 0;
+		//the first timestamp of the frame, in ms of the device's clock, to line up the queues of a device
+		double startMs = 0.0;
+		std::vector<FPassTiming> passes;
+	};
+
+private:
+	struct FScope
+	{
+		const char* name;
+		uint32_t beginQuery;
+	};
+
+	struct FFrameQueries
+	{
+		VkQueryPool pool = VK_NULL_HANDLE;
+		std::vector<FScope> scopes;
+		uint32_t usedScopes = 0;
+		uint64_t frame = 0;
+		//the queries were reset and written by a submitted frame
+		bool pending = false;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	double timestampPeriod = 1.0;
+	uint64_t timestampMask = ~0ull;
+	uint32_t maxScopes = 0;
+	bool enabled = false;
+
+	std::vector<FFrameQueries> frames;
+	uint32_t currentFrame = 0;
+	//scopes can be opened from the recording threads
+	std::atomic<uint32_t> scopeCount{ 0 };
+
+	std::vector<FFrameTimings> history;
+	size_t historyHead = 0;
+	size_t historySize = 0;
+
+	std::vector<uint64_t> results;
+
+public:
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+		uint32_t maxScopes = 64, uint32_t historyFrames = 240);
+	void destroy();
+
+	//the frame's fence has to be signaled, reads the results of the last frame that used this slot
+	void beginFrame(uint32_t frameIndex, uint64_t frameNumber);
+	//outside of a render pass, before any scope of the frame
+	void recordReset(VkCommandBuffer commandBuffer);
+
+	//name has to outlive the results, string literals only
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const char* name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+	bool isEnabled() const { return enabled; }
+
+	//the newest frame is last
+	std::vector<FFrameTimings> getHistory() const;
+	//nullptr until a frame was read back
+	const FFrameTimings* getLatestFrame() const;
+	//average time of each pass over the history
+	void printAverages() const;
+
+private:
+	void collect(FFrameQueries& frame);
+};
+
+//times the commands recorded between its construction and destruction
+class GpuScope
+{
+	GpuProfiler& profiler;
+	VkCommandBuffer commandBuffer;
+	uint32_t scope;
+
+public:
+	GpuScope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, const char* name)
+		: profiler(profiler), commandBuffer(commandBuffer), scope(profiler.beginScope(commandBuffer, name))
+	{
+	}
+
+	~GpuScope()
+	{
+		profiler.endScope(commandBuffer, scope);
+	}
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+};
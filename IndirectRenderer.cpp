@@ -0,0 +1,241 @@
+#include "IndirectRenderer.h"
+
+#include <cstddef>
+#include <iostream>
+
+#include "FileIO.h"
+#include "SpirvReflection.h"
+
+//the count is padded to 16 bytes, the commands follow
+constexpr VkDeviceSize cdrawCommandsOffset = 16;
+constexpr uint32_t ccullGroupSize = 64;
+
+//same as the push constants of Shaders/cull.comp
+struct FCullPush
+{
+	uint32_t objectCount;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t compact;
+};
+
+VertexLayout FGpuObject::getLayout()
+{
+	VertexLayout layout(1, sizeof(FGpuObject), VK_VERTEX_INPUT_RATE_INSTANCE, 2);
+
+	layout.addAttribute(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FGpuObject, rows))
+		.addAttribute(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FGpuObject, rows) + sizeof(glm::vec4))
+		.addAttribute(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FGpuObject, rows) + 2 * sizeof(glm::vec4));
+
+	return layout;
+}
+
+bool IndirectRenderer::init(VkDevice device, MemoryAllocator& allocator, LayoutCache& layoutCache, PipelineCache& pipelineCache,
+	uint32_t framesInFlight, uint32_t maxObjects, bool drawCount, bool multiDraw, const VkPhysicalDeviceLimits& limits)
+{
+	this->device = device;
+	this->allocator = &allocator;
+	drawCountEnabled = drawCount;
+	multiDrawEnabled = multiDraw;
+
+	if(drawCountEnabled)
+	{
+		cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCount"));
+		drawCountEnabled = cmdDrawIndexedIndirectCount != nullptr;
+	}
+
+	//the packed commands only have one count from the gpu, so they can't be split across several calls
+	//65535 is the guaranteed minimum, without multiDrawIndirect each call takes a single command anyway
+	if((drawCountEnabled || multiDrawEnabled) && maxObjects > limits.maxDrawIndirectCount)
+	{
+		std::cout << "Gpu driven draws limited to maxDrawIndirectCount, " << limits.maxDrawIndirectCount << " objects" << std::endl;
+		maxObjects = limits.maxDrawIndirectCount;
+	}
+
+	this->maxObjects = maxObjects;
+
+	MappedFile shaderFile;
+	FSpirvView shaderCode = mapSpirv("Shaders/cull.spv", shaderFile);
+
+	if (!shaderCode.isValid())
+		return false;
+
+	FShaderReflection reflection;
+	std::vector<VkDescriptorSetLayout> setLayouts;
+
+	if (reflectSpirv(shaderCode, reflection))
+		cullLayout = layoutCache.getPipelineLayout(mergeReflections({ &reflection }), &setLayouts);
+
+	if(cullLayout == VK_NULL_HANDLE || setLayouts.empty())
+	{
+		std::cout << "Unable to make the culling pipeline layout" << std::endl;
+		cullLayout = VK_NULL_HANDLE;
+		return false;
+	}
+
+	cullSetLayout = setLayouts[0];
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.size;
+	moduleInfo.pCode = shaderCode.code;
+
+	VkShaderModule shaderModule;
+	if(vkCreateShaderModule(device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the culling shader module" << std::endl;
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = cullLayout;
+
+	if(vkCreateComputePipelines(device, pipelineCache.getHandle(), 1, &pipelineInfo, nullptr, &cullPipeline) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the culling pipeline" << std::endl;
+		cullPipeline = VK_NULL_HANDLE;
+	}
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	if (cullPipeline == VK_NULL_HANDLE)
+		return false;
+
+	//device local, only the gpu writes and reads them
+	drawBuffers.resize(framesInFlight);
+
+	for(FBuffer& drawBuffer : drawBuffers)
+	{
+		if(allocator.createBuffer(EMemoryPool::StaticGeometry, cdrawCommandsOffset + maxObjects * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, drawBuffer) != VK_SUCCESS)
+		{
+			std::cout << "Unable to create the indirect draw buffers" << std::endl;
+			destroy();
+			return false;
+		}
+	}
+
+	std::cout << "Gpu driven draws of up to " << maxObjects << " objects, "
+		<< (drawCountEnabled ? "with the draw count from the gpu" : "one slot per object") << std::endl;
+
+	return true;
+}
+
+void IndirectRenderer::destroy()
+{
+	for(FBuffer& drawBuffer : drawBuffers)
+	{
+		allocator->destroyBuffer(drawBuffer);
+	}
+
+	drawBuffers.clear();
+
+	//the layouts belong to the layout cache
+	if (cullPipeline != VK_NULL_HANDLE)
+		vkDestroyPipeline(device, cullPipeline, nullptr);
+
+	cullPipeline = VK_NULL_HANDLE;
+	cullLayout = VK_NULL_HANDLE;
+	cullSetLayout = VK_NULL_HANDLE;
+
+	objects = VK_NULL_HANDLE;
+	objectCount = 0;
+}
+
+void IndirectRenderer::beginFrame(uint32_t frameIndex)
+{
+	currentFrame = frameIndex;
+}
+
+bool IndirectRenderer::setObjects(VkBuffer objectBuffer, uint32_t count)
+{
+	if(count > maxObjects)
+	{
+		std::cout << "Unable to draw " << count << " objects on the gpu, the draw buffers hold " << maxObjects << std::endl;
+		return false;
+	}
+
+	objects = objectBuffer;
+	objectCount = objectBuffer != VK_NULL_HANDLE ? count : 0;
+
+	return true;
+}
+
+void IndirectRenderer::recordCulling(VkCommandBuffer commandBuffer, DescriptorAllocator& descriptors, const FMesh& mesh)
+{
+	if (!isValid() || objectCount == 0)
+		return;
+
+	const FBuffer& drawBuffer = drawBuffers[currentFrame];
+
+	//the commands are appended, the count starts from 0 every frame
+	if(drawCountEnabled)
+	{
+		vkCmdFillBuffer(commandBuffer, drawBuffer.buffer, 0, sizeof(uint32_t), 0);
+
+		VkMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &clearBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	FDescriptorWrites writes;
+	writes.writeBuffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objects)
+		.writeBuffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, drawBuffer.buffer);
+
+	VkDescriptorSet descriptorSet = descriptors.getSet(cullSetLayout, writes);
+
+	FCullPush push{ objectCount, mesh.indexCount, 0, 0, drawCountEnabled ? 1u : 0u };
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+	vkCmdDispatch(commandBuffer, (objectCount + ccullGroupSize - 1) / ccullGroupSize, 1, 1);
+
+	VkMemoryBarrier drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void IndirectRenderer::recordDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, const FMesh& mesh) const
+{
+	if (!isValid() || objectCount == 0)
+		return;
+
+	VkBuffer drawBuffer = drawBuffers[currentFrame].buffer;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	mesh.bind(commandBuffer);
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 1, 1, &objects, &offset);
+
+	if(drawCountEnabled)
+	{
+		cmdDrawIndexedIndirectCount(commandBuffer, drawBuffer, cdrawCommandsOffset, drawBuffer, 0,
+			objectCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else if(multiDrawEnabled)
+	{
+		vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, cdrawCommandsOffset, objectCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		//one command per call without multiDrawIndirect, still nothing for the cpu to cull
+		for (uint32_t i = 0; i < objectCount; i++)
+			vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, cdrawCommandsOffset + i * sizeof(VkDrawIndexedIndirectCommand), 1, 0);
+	}
+}
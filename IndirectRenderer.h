@@ -0,0 +1,75 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+#include "LayoutCache.h"
+#include "MemoryAllocator.h"
+#include "Mesh.h"
+#include "PipelineCache.h"
+
+//an object of the scene as Shaders/cull.comp reads it, the rows start like an FInstance
+//so the same buffer is read per instance by the vertex shader, through the firstInstance written by the culling
+struct FGpuObject
+{
+	glm::vec4 rows[3];
+	//bounding sphere in the space of the mesh, xyz the center and w the radius
+	glm::vec4 bounds;
+
+	//the rows on locations 2 to 4 of binding 1, like FInstance::getLayout but with the stride of an object
+	static VertexLayout getLayout();
+};
+
+//draws a whole object buffer without the cpu looking at the objects
+//a compute pass culls them against the screen and writes the indirect commands of the visible ones, the graphics consume them
+//with drawIndirectCount the commands are packed and their count comes from the gpu too
+//otherwise each object has its slot, an instance count of 0 when culled
+class IndirectRenderer
+{
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout cullLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout cullSetLayout = VK_NULL_HANDLE;
+
+	//the draw count then the commands, one per frame in flight since the culling of a frame overwrites them
+	std::vector<FBuffer> drawBuffers;
+	uint32_t currentFrame = 0;
+	uint32_t maxObjects = 0;
+
+	//owned by the caller
+	VkBuffer objects = VK_NULL_HANDLE;
+	uint32_t objectCount = 0;
+
+	bool drawCountEnabled = false;
+	bool multiDrawEnabled = false;
+
+	//a 1.2 function, looked up so older loaders can still run without it
+	PFN_vkCmdDrawIndexedIndirectCount cmdDrawIndexedIndirectCount = nullptr;
+
+public:
+	//drawIndirectFirstInstance has to be enabled on the device, drawCount and multiDraw are the features of the same name
+	//maxObjects is clamped to maxDrawIndirectCount, every object is drawn by the same indirect call
+	//false if Shaders/cull.spv can't be loaded
+	bool init(VkDevice device, MemoryAllocator& allocator, LayoutCache& layoutCache, PipelineCache& pipelineCache,
+		uint32_t framesInFlight, uint32_t maxObjects, bool drawCount, bool multiDraw, const VkPhysicalDeviceLimits& limits);
+	void destroy();
+
+	//the frame's fence signaled, its draw buffer can be written again
+	void beginFrame(uint32_t frameIndex);
+
+	//FGpuObjects in a buffer with the storage and vertex usages, it has to live as long as the frames drawing it
+	//false if there are more than maxObjects
+	bool setObjects(VkBuffer objectBuffer, uint32_t count);
+
+	//outside of the render pass, the set comes from the frame's descriptors
+	void recordCulling(VkCommandBuffer commandBuffer, DescriptorAllocator& descriptors, const FMesh& mesh);
+	//inside the render pass, pipeline has to take FVertex on binding 0 and FGpuObject::getLayout on binding 1
+	void recordDraws(VkCommandBuffer commandBuffer, VkPipeline pipeline, const FMesh& mesh) const;
+
+	bool isValid() const { return cullPipeline != VK_NULL_HANDLE; }
+	bool hasObjects() const { return objectCount > 0; }
+	uint32_t getObjectCount() const { return objectCount; }
+	uint32_t getMaxObjects() const { return maxObjects; }
+};
@@ -0,0 +1,192 @@
+#include "InstanceBatcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+//enough for a few thousand instances, the buffers double from there
+constexpr VkDeviceSize cminInstanceBufferSize = 64 * 1024;
+
+size_t InstanceBatcher::FBatchKeyHash::operator()(const FBatchKey& key) const
+{
+	size_t seed = std::hash<const void*>()(key.mesh);
+	seed ^= std::hash<const void*>()(key.pipeline) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+
+	return seed;
+}
+
+void InstanceBatcher::init(MemoryAllocator& allocator, uint32_t framesInFlight)
+{
+	this->allocator = &allocator;
+
+	instanceBuffers.resize(framesInFlight);
+}
+
+void InstanceBatcher::destroy()
+{
+	for(FBuffer& buffer : instanceBuffers)
+	{
+		allocator->destroyBuffer(buffer);
+	}
+
+	instanceBuffers.clear();
+	batches.clear();
+	batchIndices.clear();
+	usedBatches = 0;
+	instanceCount = 0;
+}
+
+void InstanceBatcher::beginFrame(uint32_t frameIndex)
+{
+	currentFrame = frameIndex;
+
+	for(uint32_t i = 0; i < usedBatches; i++)
+	{
+		batches[i].instances.clear();
+	}
+
+	usedBatches = 0;
+	instanceCount = 0;
+	batchIndices.clear();
+}
+
+void InstanceBatcher::add(const FMesh& mesh, VkPipeline pipeline, const FInstance& instance)
+{
+	FBatchKey key{ &mesh, pipeline };
+	auto it = batchIndices.find(key);
+
+	uint32_t index;
+
+	if(it != batchIndices.end())
+	{
+		index = it->second;
+	}
+	else
+	{
+		index = usedBatches++;
+
+		if (index == batches.size())
+			batches.emplace_back();
+
+		batches[index].mesh = &mesh;
+		batches[index].pipeline = pipeline;
+		batchIndices.emplace(key, index);
+	}
+
+	batches[index].instances.push_back(instance);
+	instanceCount++;
+}
+
+bool InstanceBatcher::upload()
+{
+	if (instanceCount == 0)
+		return true;
+
+	FBuffer& buffer = instanceBuffers[currentFrame];
+	VkDeviceSize size = instanceCount * sizeof(FInstance);
+
+	//the last frame that used this buffer is done, it can go right away
+	if(buffer.size < size)
+	{
+		VkDeviceSize newSize = std::max(buffer.size * 2, cminInstanceBufferSize);
+
+		while (newSize < size)
+			newSize *= 2;
+
+		//the pool hands out bigger buffers than its blocks on their own memory
+		FBuffer newBuffer;
+		if(allocator->createBuffer(EMemoryPool::FrameDynamic, newSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, newBuffer) == VK_SUCCESS)
+		{
+			allocator->destroyBuffer(buffer);
+			buffer = newBuffer;
+		}
+		else
+		{
+			std::cout << "Unable to grow the instance buffer to " << newSize << " bytes, drawing what fits in " << buffer.size << std::endl;
+			fitInstances(static_cast<uint32_t>(buffer.size / sizeof(FInstance)));
+			size = instanceCount * sizeof(FInstance);
+
+			if (instanceCount == 0)
+				return false;
+		}
+	}
+
+	uint32_t firstInstance = 0;
+
+	for(uint32_t i = 0; i < usedBatches; i++)
+	{
+		FBatch& batch = batches[i];
+
+		memcpy(static_cast<FInstance*>(buffer.mapped) + firstInstance, batch.instances.data(), batch.instances.size() * sizeof(FInstance));
+
+		batch.firstInstance = firstInstance;
+		firstInstance += static_cast<uint32_t>(batch.instances.size());
+	}
+
+	//the memory may not be coherent
+	vmaFlushAllocation(allocator->getHandle(), buffer.allocation, 0, size);
+
+	return true;
+}
+
+void InstanceBatcher::fitInstances(uint32_t maxInstances)
+{
+	uint32_t kept = 0;
+	uint32_t keptBatches = 0;
+
+	for(uint32_t i = 0; i < usedBatches && kept < maxInstances; i++)
+	{
+		std::vector<FInstance>& instances = batches[i].instances;
+
+		if (instances.size() > maxInstances - kept)
+			instances.resize(maxInstances - kept);
+
+		kept += static_cast<uint32_t>(instances.size());
+		keptBatches++;
+	}
+
+	//beginFrame only clears the used batches
+	for(uint32_t i = keptBatches; i < usedBatches; i++)
+	{
+		batches[i].instances.clear();
+	}
+
+	std::cout << "Dropped " << instanceCount - kept << " instances and " << usedBatches - keptBatches << " batches this frame" << std::endl;
+
+	usedBatches = keptBatches;
+	instanceCount = kept;
+}
+
+void InstanceBatcher::record(VkCommandBuffer commandBuffer) const
+{
+	if (usedBatches == 0)
+		return;
+
+	VkBuffer instanceBuffer = instanceBuffers[currentFrame].buffer;
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &offset);
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	const FMesh* boundMesh = nullptr;
+
+	for(uint32_t i = 0; i < usedBatches; i++)
+	{
+		const FBatch& batch = batches[i];
+
+		if(batch.pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.pipeline);
+			boundPipeline = batch.pipeline;
+		}
+
+		//only rebinds binding 0, the instance buffer stays
+		if(batch.mesh != boundMesh)
+		{
+			batch.mesh->bind(commandBuffer);
+			boundMesh = batch.mesh;
+		}
+
+		vkCmdDrawIndexed(commandBuffer, batch.mesh->indexCount, static_cast<uint32_t>(batch.instances.size()), 0, 0, batch.firstInstance);
+	}
+}
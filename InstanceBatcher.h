@@ -0,0 +1,69 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <vector>
+
+#include "MemoryAllocator.h"
+#include "Mesh.h"
+
+//gathers the objects of a frame by mesh and pipeline, and draws each group with a single instanced draw
+//the transforms of every batch are packed one after the other in the frame's instance buffer, bound once on binding 1
+//each batch reads its slice through firstInstance, so the draws don't need anything else bound in between
+class InstanceBatcher
+{
+	struct FBatch
+	{
+		const FMesh* mesh;
+		VkPipeline pipeline;
+		std::vector<FInstance> instances;
+		//where the batch starts in the instance buffer, set by upload
+		uint32_t firstInstance = 0;
+	};
+
+	struct FBatchKey
+	{
+		const FMesh* mesh;
+		VkPipeline pipeline;
+
+		bool operator==(const FBatchKey& other) const { return mesh == other.mesh && pipeline == other.pipeline; }
+	};
+
+	struct FBatchKeyHash
+	{
+		size_t operator()(const FBatchKey& key) const;
+	};
+
+	MemoryAllocator* allocator = nullptr;
+
+	//one per frame in flight, host visible and only grown when a frame has more instances than ever
+	std::vector<FBuffer> instanceBuffers;
+	uint32_t currentFrame = 0;
+
+	//kept from frame to frame so the instance vectors don't allocate again, only usedBatches are drawn
+	std::vector<FBatch> batches;
+	uint32_t usedBatches = 0;
+	std::unordered_map<FBatchKey, uint32_t, FBatchKeyHash> batchIndices;
+
+	uint32_t instanceCount = 0;
+
+public:
+	void init(MemoryAllocator& allocator, uint32_t framesInFlight);
+	void destroy();
+
+	//the frame's fence signaled, its instance buffer can be written again
+	void beginFrame(uint32_t frameIndex);
+
+	void add(const FMesh& mesh, VkPipeline pipeline, const FInstance& instance);
+
+	//copies the instances of the frame in its buffer, before recording
+	bool upload();
+	//one vkCmdDrawIndexed per batch, the viewport, scissor and the descriptor sets have to be set already
+	void record(VkCommandBuffer commandBuffer) const;
+
+	uint32_t getBatchCount() const { return usedBatches; }
+	uint32_t getInstanceCount() const { return instanceCount; }
+
+private:
+	//keeps the first instances up to maxInstances, in batch order, when the buffer couldn't grow
+	void fitInstances(uint32_t maxInstances);
+};
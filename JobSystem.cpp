@@ -0,0 +1,77 @@
+#include "JobSystem.h"
+
+void JobSystem::init(uint32_t threadCount)
+{
+	stopping = false;
+	workers.reserve(threadCount);
+
+	for(uint32_t i = 0; i < threadCount; i++)
+	{
+		//the system may have been restarted, only the dispatches from now on are for the new workers
+		workers.emplace_back(&JobSystem::workerLoop, this, i, generation);
+	}
+}
+
+void JobSystem::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wakeCondition.notify_all();
+
+	for(std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	workers.clear();
+}
+
+void JobSystem::dispatch(const std::function<void(uint32_t)>& job)
+{
+	if (workers.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	this->job = &job;
+	pendingWorkers = static_cast<uint32_t>(workers.size());
+	generation++;
+
+	wakeCondition.notify_all();
+	doneCondition.wait(lock, [this]() { return pendingWorkers == 0; });
+
+	this->job = nullptr;
+}
+
+void JobSystem::workerLoop(uint32_t workerIndex, uint64_t startGeneration)
+{
+	uint64_t lastGeneration = startGeneration;
+
+	while(true)
+	{
+		const std::function<void(uint32_t)>* currentJob;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&]() { return stopping || generation != lastGeneration; });
+
+			if (stopping)
+				return;
+
+			lastGeneration = generation;
+			currentJob = job;
+		}
+
+		(*currentJob)(workerIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pendingWorkers--;
+		}
+
+		doneCondition.notify_one();
+	}
+}
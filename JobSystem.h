@@ -0,0 +1,36 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//a fixed set of worker threads that all run the same job, each one with its own index
+//used to split work like command recording into one slice per thread
+class JobSystem
+{
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	//only valid during dispatch, which waits for the workers before returning
+	const std::function<void(uint32_t)>* job = nullptr;
+	uint64_t generation = 0;
+	uint32_t pendingWorkers = 0;
+	bool stopping = false;
+
+public:
+	void init(uint32_t threadCount);
+	void destroy();
+
+	uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+	//runs job(workerIndex) once on every worker, returns when all of them are done
+	void dispatch(const std::function<void(uint32_t)>& job);
+
+private:
+	void workerLoop(uint32_t workerIndex, uint64_t startGeneration);
+};
@@ -0,0 +1,229 @@
+#include "LayoutCache.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+static void hashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+static size_t hashBindings(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	size_t seed = bindings.size();
+
+	for(const VkDescriptorSetLayoutBinding& binding : bindings)
+	{
+		hashCombine(seed, binding.binding);
+		hashCombine(seed, binding.descriptorType);
+		hashCombine(seed, binding.descriptorCount);
+		hashCombine(seed, binding.stageFlags);
+	}
+
+	return seed;
+}
+
+static bool areBindingsEqual(const std::vector<VkDescriptorSetLayoutBinding>& a, const std::vector<VkDescriptorSetLayoutBinding>& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for(size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].binding != b[i].binding || a[i].descriptorType != b[i].descriptorType
+			|| a[i].descriptorCount != b[i].descriptorCount || a[i].stageFlags != b[i].stageFlags)
+			return false;
+	}
+
+	return true;
+}
+
+static bool arePushConstantsEqual(const std::vector<VkPushConstantRange>& a, const std::vector<VkPushConstantRange>& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for(size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].stageFlags != b[i].stageFlags || a[i].offset != b[i].offset || a[i].size != b[i].size)
+			return false;
+	}
+
+	return true;
+}
+
+void LayoutCache::init(VkDevice device)
+{
+	this->device = device;
+}
+
+void LayoutCache::destroy()
+{
+	for (auto& entry : pipelineLayouts)
+		vkDestroyPipelineLayout(device, entry.second.layout, nullptr);
+
+	for (auto& entry : setLayouts)
+		vkDestroyDescriptorSetLayout(device, entry.second.layout, nullptr);
+
+	pipelineLayouts.clear();
+	setLayouts.clear();
+}
+
+VkDescriptorSetLayout LayoutCache::getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t hash = hashBindings(bindings);
+	auto range = setLayouts.equal_range(hash);
+
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(areBindingsEqual(it->second.bindings, bindings))
+		{
+			hits++;
+			return it->second.layout;
+		}
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+
+	if(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create a descriptor set layout" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	misses++;
+	setLayouts.insert({ hash, { bindings, layout } });
+
+	return layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//the set layouts are unique handles, hashing them is hashing their description
+	size_t hash = setLayouts.size();
+
+	for (VkDescriptorSetLayout setLayout : setLayouts)
+		hashCombine(hash, std::hash<VkDescriptorSetLayout>()(setLayout));
+
+	for(const VkPushConstantRange& range : pushConstants)
+	{
+		hashCombine(hash, range.stageFlags);
+		hashCombine(hash, range.offset);
+		hashCombine(hash, range.size);
+	}
+
+	auto range = pipelineLayouts.equal_range(hash);
+
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(it->second.setLayouts == setLayouts && arePushConstantsEqual(it->second.pushConstants, pushConstants))
+		{
+			hits++;
+			return it->second.layout;
+		}
+	}
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	layoutInfo.pSetLayouts = setLayouts.data();
+	layoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+	layoutInfo.pPushConstantRanges = pushConstants.data();
+
+	VkPipelineLayout layout;
+
+	if(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+	{
+		std::cout << "Couldn't create pipeline layout" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	misses++;
+	pipelineLayouts.insert({ hash, { setLayouts, pushConstants, layout } });
+
+	return layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const FPipelineReflection& reflection, std::vector<VkDescriptorSetLayout>* setLayouts,
+	VkDescriptorSetLayout bindlessLayout)
+{
+	//the heap replaces the set, so a shader declaring something else in it would read the wrong descriptors
+	if(bindlessLayout != VK_NULL_HANDLE && cbindlessSet < reflection.sets.size() && !BindlessHeap::matchesHeap(reflection.sets[cbindlessSet]))
+	{
+		std::cout << "The shaders declare their own resources in set " << cbindlessSet << ", which is the bindless heap, move them to another set" << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts;
+	layouts.reserve(reflection.sets.size());
+
+	//shaders that don't read the heap still get it, so every layout is compatible with the set bound once per command buffer
+	size_t setCount = bindlessLayout != VK_NULL_HANDLE ? std::max<size_t>(reflection.sets.size(), cbindlessSet + 1) : reflection.sets.size();
+
+	for(size_t i = 0; i < setCount; i++)
+	{
+		if(bindlessLayout != VK_NULL_HANDLE && i == cbindlessSet)
+		{
+			layouts.push_back(bindlessLayout);
+			continue;
+		}
+
+		//a set between used ones, it can be empty
+		std::vector<VkDescriptorSetLayoutBinding> bindings = i < reflection.sets.size() ? reflection.sets[i] : std::vector<VkDescriptorSetLayoutBinding>();
+
+		//the reflection can't tell a dynamic uniform buffer from a plain one, the set decides
+		if(i == cdynamicUniformSet)
+		{
+			for(VkDescriptorSetLayoutBinding& binding : bindings)
+			{
+				if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+					binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+			}
+		}
+
+		VkDescriptorSetLayout layout = getSetLayout(bindings);
+
+		if (layout == VK_NULL_HANDLE)
+			return VK_NULL_HANDLE;
+
+		layouts.push_back(layout);
+	}
+
+	if (setLayouts)
+		*setLayouts = layouts;
+
+	return getPipelineLayout(layouts, reflection.pushConstants);
+}
+
+bool LayoutCache::getSetLayouts(VkPipelineLayout layout, std::vector<VkDescriptorSetLayout>& setLayouts)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//only asked for when the pipelines change, a search is fine
+	for(const auto& entry : pipelineLayouts)
+	{
+		if(entry.second.layout == layout)
+		{
+			setLayouts = entry.second.setLayouts;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void LayoutCache::printStats() const
+{
+	std::cout << "Layout cache: " << setLayouts.size() << " set layouts, " << pipelineLayouts.size() << " pipeline layouts, "
+		<< hits << " hits, " << misses << " misses" << std::endl;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BindlessHeap.h"
+#include "SpirvReflection.h"
+
+//the per draw uniforms, the uniform buffers the shaders declare in this set are made UNIFORM_BUFFER_DYNAMIC
+//so the set is written once per frame and each draw binds it at its own offset
+constexpr uint32_t cdynamicUniformSet = 1;
+
+//descriptor set layouts and pipeline layouts, made once for each description and shared by every pipeline asking for it
+//so pipelines made from different shaders with the same resources can keep the same descriptor sets bound
+//keyed by a hash of the description, the handles live until destroy
+class LayoutCache
+{
+	struct FSetLayoutEntry
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		VkDescriptorSetLayout layout;
+	};
+
+	struct FPipelineLayoutEntry
+	{
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		std::vector<VkPushConstantRange> pushConstants;
+		VkPipelineLayout layout;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+
+	std::unordered_multimap<size_t, FSetLayoutEntry> setLayouts;
+	std::unordered_multimap<size_t, FPipelineLayoutEntry> pipelineLayouts;
+
+	//the shader hot reload asks for layouts from its own thread
+	std::mutex mutex;
+
+	uint32_t hits = 0;
+	uint32_t misses = 0;
+
+public:
+	void init(VkDevice device);
+	void destroy();
+
+	//the bindings have to be sorted by binding, no immutable samplers
+	VkDescriptorSetLayout getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+	//the layout of every set of the reflection, then the pipeline layout, setLayouts gets the sets to allocate from them
+	//with a bindlessLayout, set cbindlessSet is always the bindless heap, VK_NULL_HANDLE if the shaders declare anything else in it
+	VkPipelineLayout getPipelineLayout(const FPipelineReflection& reflection, std::vector<VkDescriptorSetLayout>* setLayouts = nullptr,
+		VkDescriptorSetLayout bindlessLayout = VK_NULL_HANDLE);
+	//the set layouts a pipeline layout of the cache was made with, false if it isn't one of them
+	bool getSetLayouts(VkPipelineLayout layout, std::vector<VkDescriptorSetLayout>& setLayouts);
+
+	void printStats() const;
+};
@@ -0,0 +1,182 @@
+#include "MemoryAllocator.h"
+
+#include <iostream>
+
+static const char* cpoolNames[] = { "static geometry", "frame dynamic", "staging" };
+
+void MemoryAllocator::init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, bool useMemoryBudget)
+{
+	VmaAllocatorCreateInfo createInfo{};
+	createInfo.instance = instance;
+	createInfo.physicalDevice = physicalDevice;
+	createInfo.device = device;
+	createInfo.vulkanApiVersion = VK_API_VERSION_1_0;
+	createInfo.frameInUseCount = framesInFlight;
+
+	//the budget is fetched from the driver instead of being estimated from the heap sizes
+	if (useMemoryBudget)
+		createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
+	budgetEnabled = useMemoryBudget;
+
+	if(vmaCreateAllocator(&createInfo, &allocator) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the memory allocator" << std::endl;
+		return;
+	}
+
+	createPool(EMemoryPool::StaticGeometry,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+		| VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY, 64ull * 1024 * 1024);
+
+	//the transient buffers of the frame contexts and the instance buffers, the bump allocation happens inside them
+	createPool(EMemoryPool::FrameDynamic,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+		| VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VMA_MEMORY_USAGE_CPU_TO_GPU, 16ull * 1024 * 1024);
+
+	createPool(EMemoryPool::Staging, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, 32ull * 1024 * 1024);
+
+	std::cout << "Memory allocator created" << (budgetEnabled ? " with the memory budget extension" : "") << std::endl;
+}
+
+void MemoryAllocator::destroy()
+{
+	if (allocator == VK_NULL_HANDLE)
+		return;
+
+	for(VmaPool& pool : pools)
+	{
+		if (pool != VK_NULL_HANDLE)
+			vmaDestroyPool(allocator, pool);
+
+		pool = VK_NULL_HANDLE;
+	}
+
+	vmaDestroyAllocator(allocator);
+	allocator = VK_NULL_HANDLE;
+}
+
+void MemoryAllocator::setFrameIndex(uint32_t frameIndex)
+{
+	vmaSetCurrentFrameIndex(allocator, frameIndex);
+}
+
+VkResult MemoryAllocator::createBuffer(EMemoryPool pool, VkDeviceSize size, VkBufferUsageFlags usage, FBuffer& buffer)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.pool = getPool(pool);
+
+	if(size > poolBlockSizes[static_cast<size_t>(pool)])
+	{
+		allocInfo.pool = VK_NULL_HANDLE;
+		allocInfo.usage = poolMemoryUsages[static_cast<size_t>(pool)];
+		allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+	}
+
+	//host visible pools stay mapped for their whole life, no map/unmap per write
+	if (pool != EMemoryPool::StaticGeometry)
+		allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocationInfo{};
+	VkResult res = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer.buffer, &buffer.allocation, &allocationInfo);
+
+	if(res != VK_SUCCESS)
+	{
+		std::cout << "Unable to allocate a buffer of " << size << " bytes in the " << cpoolNames[static_cast<size_t>(pool)] << " pool" << std::endl;
+		return res;
+	}
+
+	buffer.size = size;
+	buffer.mapped = allocationInfo.pMappedData;
+
+	return res;
+}
+
+void MemoryAllocator::destroyBuffer(FBuffer& buffer)
+{
+	if (buffer.buffer != VK_NULL_HANDLE)
+		vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+
+	buffer = FBuffer{};
+}
+
+VkResult MemoryAllocator::createImage(const VkImageCreateInfo& imageInfo, FImage& image)
+{
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+	VkResult res = vmaCreateImage(allocator, &imageInfo, &allocInfo, &image.image, &image.allocation, nullptr);
+
+	if(res != VK_SUCCESS)
+	{
+		std::cout << "Unable to allocate a " << imageInfo.extent.width << "x" << imageInfo.extent.height << " image" << std::endl;
+	}
+
+	return res;
+}
+
+void MemoryAllocator::destroyImage(FImage& image)
+{
+	if (image.image != VK_NULL_HANDLE)
+		vmaDestroyImage(allocator, image.image, image.allocation);
+
+	image = FImage{};
+}
+
+void MemoryAllocator::printBudget() const
+{
+	const VkPhysicalDeviceMemoryProperties* memoryProperties;
+	vmaGetMemoryProperties(allocator, &memoryProperties);
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetBudget(allocator, budgets);
+
+	for(uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++)
+	{
+		std::cout << "Heap " << i << ": " << budgets[i].allocationBytes / 1024 << " KiB allocated in "
+			<< budgets[i].blockBytes / 1024 << " KiB of blocks, usage " << budgets[i].usage / 1024
+			<< " KiB / budget " << budgets[i].budget / 1024 << " KiB" << std::endl;
+	}
+}
+
+void MemoryAllocator::createPool(EMemoryPool pool, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, VkDeviceSize blockSize)
+{
+	poolBlockSizes[static_cast<size_t>(pool)] = blockSize;
+	poolMemoryUsages[static_cast<size_t>(pool)] = memoryUsage;
+
+	//a vma pool lives in a single memory type, so we ask which one a typical buffer of this pool would end up in
+	VkBufferCreateInfo sampleBufferInfo{};
+	sampleBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	sampleBufferInfo.size = 1024;
+	sampleBufferInfo.usage = usage;
+	sampleBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo sampleAllocInfo{};
+	sampleAllocInfo.usage = memoryUsage;
+
+	VmaPoolCreateInfo poolInfo{};
+
+	if(vmaFindMemoryTypeIndexForBufferInfo(allocator, &sampleBufferInfo, &sampleAllocInfo, &poolInfo.memoryTypeIndex) != VK_SUCCESS)
+	{
+		std::cout << "No memory type for the " << cpoolNames[static_cast<size_t>(pool)] << " pool" << std::endl;
+		return;
+	}
+
+	poolInfo.blockSize = blockSize;
+
+	VmaPool& vmaPool = pools[static_cast<size_t>(pool)];
+
+	if(vmaCreatePool(allocator, &poolInfo, &vmaPool) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the " << cpoolNames[static_cast<size_t>(pool)] << " pool" << std::endl;
+		vmaPool = VK_NULL_HANDLE;
+	}
+}
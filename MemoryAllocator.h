@@ -0,0 +1,63 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include "vk_mem_alloc.h"
+
+//which pool a buffer is sub allocated from
+enum class EMemoryPool
+{
+	StaticGeometry, //device local, written once through a staging buffer
+	FrameDynamic, //host visible, rewritten every frame
+	Staging, //host visible, source of the transfers
+	Count
+};
+
+struct FBuffer
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	VkDeviceSize size = 0;
+	//persistently mapped for the host visible pools, nullptr otherwise
+	void* mapped = nullptr;
+};
+
+struct FImage
+{
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+};
+
+//owns the VmaAllocator, every resource is sub allocated from big blocks instead of one vkAllocateMemory each
+class MemoryAllocator
+{
+	VmaAllocator allocator = VK_NULL_HANDLE;
+	VmaPool pools[static_cast<size_t>(EMemoryPool::Count)]{};
+	//a buffer bigger than a block can't be in the pool, it gets its own memory of the same usage
+	VkDeviceSize poolBlockSizes[static_cast<size_t>(EMemoryPool::Count)]{};
+	VmaMemoryUsage poolMemoryUsages[static_cast<size_t>(EMemoryPool::Count)]{};
+
+	bool budgetEnabled = false;
+
+public:
+	//useMemoryBudget only if VK_EXT_memory_budget was enabled on the device
+	void init(VkInstance instance, VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, bool useMemoryBudget);
+	void destroy();
+
+	//lets vma know which frame we are on, to compute the budget and the allocations in use
+	void setFrameIndex(uint32_t frameIndex);
+
+	VkResult createBuffer(EMemoryPool pool, VkDeviceSize size, VkBufferUsageFlags usage, FBuffer& buffer);
+	void destroyBuffer(FBuffer& buffer);
+
+	//device local, outside of the buffer pools since images don't share memory types with them
+	VkResult createImage(const VkImageCreateInfo& imageInfo, FImage& image);
+	void destroyImage(FImage& image);
+
+	VmaAllocator getHandle() const { return allocator; }
+	VmaPool getPool(EMemoryPool pool) const { return pools[static_cast<size_t>(pool)]; }
+
+	void printBudget() const;
+
+private:
+	void createPool(EMemoryPool pool, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, VkDeviceSize blockSize);
+};
@@ -0,0 +1,40 @@
+#include "Mesh.h"
+
+#include <cstddef>
+
+VertexLayout FVertex::getLayout()
+{
+	VertexLayout layout(0, sizeof(FVertex));
+
+	layout.addAttribute(VK_FORMAT_R32G32_SFLOAT, offsetof(FVertex, position))
+		.addAttribute(VK_FORMAT_R32G32B32_SFLOAT, offsetof(FVertex, color));
+
+	return layout;
+}
+
+FInstance FInstance::fromMatrix(const glm::mat4& transform)
+{
+	//glm is column major, the rows are read across the columns
+	glm::mat4 transposed = glm::transpose(transform);
+
+	return { { transposed[0], transposed[1], transposed[2] } };
+}
+
+VertexLayout FInstance::getLayout()
+{
+	VertexLayout layout(1, sizeof(FInstance), VK_VERTEX_INPUT_RATE_INSTANCE, 2);
+
+	layout.addAttribute(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FInstance, rows))
+		.addAttribute(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FInstance, rows) + sizeof(glm::vec4))
+		.addAttribute(VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(FInstance, rows) + 2 * sizeof(glm::vec4));
+
+	return layout;
+}
+
+void FMesh::bind(VkCommandBuffer commandBuffer) const
+{
+	VkDeviceSize offset = 0;
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
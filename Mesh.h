@@ -0,0 +1,42 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include "MemoryAllocator.h"
+#include "VertexLayout.h"
+
+struct FVertex
+{
+	glm::vec2 position;
+	glm::vec3 color;
+
+	//matches the inputs of Shaders/vertex.vert
+	static VertexLayout getLayout();
+};
+
+//the transform of one instance, the first 3 rows of its matrix (the last one is always 0 0 0 1)
+//48 bytes instead of the 64 of a mat4, streamed per instance on binding 1
+struct FInstance
+{
+	glm::vec4 rows[3];
+
+	static FInstance fromMatrix(const glm::mat4& transform);
+
+	//matches the instance inputs of Shaders/instanced.vert, after the ones of FVertex
+	static VertexLayout getLayout();
+};
+
+//a vertex and an index buffer living in device local memory
+struct FMesh
+{
+	FBuffer vertexBuffer;
+	FBuffer indexBuffer;
+
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+
+	//bounding sphere of the vertices, xyz the center and w the radius
+	glm::vec4 bounds = glm::vec4(0.0f);
+
+	void bind(VkCommandBuffer commandBuffer) const;
+};
@@ -0,0 +1,197 @@
+#include "PipelineCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+constexpr uint32_t cpipelineCacheMagic = 0x4B435050; // "PPCK"
+constexpr uint32_t cpipelineCacheFileVersion = 1;
+
+void PipelineCache::init(VkDevice device, VkPhysicalDevice physicalDevice, const char* path)
+{
+	this->device = device;
+	this->path = path;
+
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	std::vector<char> blob = load();
+	loadedFromDisk = !blob.empty();
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = blob.size();
+	createInfo.pInitialData = blob.empty() ? nullptr : blob.data();
+
+	if(vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the pipeline cache, retrying without the data on disk" << std::endl;
+
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		loadedFromDisk = false;
+
+		if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache) != VK_SUCCESS)
+		{
+			std::cout << "Unable to create the pipeline cache" << std::endl;
+			cache = VK_NULL_HANDLE;
+		}
+	}
+
+	std::cout << "Pipeline cache " << (loadedFromDisk ? "loaded from " : "starting cold, no valid data in ") << this->path << std::endl;
+}
+
+void PipelineCache::destroy()
+{
+	if (cache == VK_NULL_HANDLE)
+		return;
+
+	save();
+	printStats();
+
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::save()
+{
+	size_t dataSize = queryDataSize();
+
+	if (dataSize == 0)
+		return false;
+
+	std::vector<char> data(dataSize);
+
+	if(vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		std::cout << "Unable to get the pipeline cache data" << std::endl;
+		return false;
+	}
+
+	FFileHeader header{};
+	header.magic = cpipelineCacheMagic;
+	header.version = cpipelineCacheFileVersion;
+	header.vendorID = deviceProperties.vendorID;
+	header.deviceID = deviceProperties.deviceID;
+	header.driverVersion = deviceProperties.driverVersion;
+	memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if(!file.is_open())
+	{
+		std::cout << "failed to open " << path << " to save the pipeline cache" << std::endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(data.data(), dataSize);
+
+	std::cout << "Saved " << dataSize << " bytes of pipeline cache to " << path << std::endl;
+
+	return file.good();
+}
+
+VkResult PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline* pipeline)
+{
+	std::lock_guard<std::mutex> lock(createMutex);
+
+	//the driver appends every pipeline it had to compile to the cache
+	//so if the blob didn't grow, the pipeline came out of it
+	size_t sizeBefore = queryDataSize();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	VkResult res = vkCreateGraphicsPipelines(device, cache, 1, &pipelineInfo, nullptr, pipeline);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	if (res != VK_SUCCESS)
+		return res;
+
+	if(cache != VK_NULL_HANDLE && queryDataSize() == sizeBefore)
+	{
+		stats.hits++;
+		stats.hitMs += ms;
+		std::cout << "Pipeline cache hit, created the pipeline in " << ms << " ms" << std::endl;
+	}
+	else
+	{
+		stats.misses++;
+		stats.missMs += ms;
+		std::cout << "Pipeline cache miss, compiled the pipeline in " << ms << " ms" << std::endl;
+	}
+
+	return res;
+}
+
+void PipelineCache::printStats() const
+{
+	std::cout << "Pipeline cache: " << stats.hits << " hits (" << stats.hitMs << " ms), "
+		<< stats.misses << " misses (" << stats.missMs << " ms)" << std::endl;
+}
+
+std::vector<char> PipelineCache::load()
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open())
+		return {};
+
+	size_t fileSize = file.tellg();
+	std::vector<char> blob(fileSize);
+
+	file.seekg(0);
+	file.read(blob.data(), fileSize);
+
+	if(!isBlobCompatible(blob))
+	{
+		std::cout << "Discarding the pipeline cache in " << path << ", it was made by another device or driver" << std::endl;
+		return {};
+	}
+
+	//only the driver data is handed to vulkan
+	return std::vector<char>(blob.begin() + sizeof(FFileHeader), blob.end());
+}
+
+bool PipelineCache::isBlobCompatible(const std::vector<char>& blob) const
+{
+	if (blob.size() < sizeof(FFileHeader) + sizeof(VkPipelineCacheHeaderVersionOne))
+		return false;
+
+	FFileHeader header;
+	memcpy(&header, blob.data(), sizeof(header));
+
+	if (header.magic != cpipelineCacheMagic || header.version != cpipelineCacheFileVersion)
+		return false;
+
+	if (header.dataSize != blob.size() - sizeof(FFileHeader))
+		return false;
+
+	if (header.vendorID != deviceProperties.vendorID
+		|| header.deviceID != deviceProperties.deviceID
+		|| header.driverVersion != deviceProperties.driverVersion
+		|| memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+		return false;
+
+	//the driver's header, in case someone else wrote the blob
+	VkPipelineCacheHeaderVersionOne driverHeader;
+	memcpy(&driverHeader, blob.data() + sizeof(FFileHeader), sizeof(driverHeader));
+
+	return driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& driverHeader.vendorID == deviceProperties.vendorID
+		&& driverHeader.deviceID == deviceProperties.deviceID
+		&& memcmp(driverHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+size_t PipelineCache::queryDataSize() const
+{
+	if (cache == VK_NULL_HANDLE)
+		return 0;
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, cache, &dataSize, nullptr);
+
+	return dataSize;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//keeps a VkPipelineCache alive for the whole run and mirrors it on disk
+//so that pipelines compiled in a previous run don't have to be compiled again
+class PipelineCache
+{
+public:
+	struct FStats
+	{
+		uint32_t hits = 0;
+		uint32_t misses = 0;
+		double hitMs = 0.0;
+		double missMs = 0.0;
+	};
+
+	//written in front of the driver blob
+	//the driver's own header has no driver version, so an updated driver would happily reuse a stale blob
+	struct FFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+	};
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceProperties deviceProperties{};
+	VkPipelineCache cache = VK_NULL_HANDLE;
+
+	std::string path;
+	bool loadedFromDisk = false;
+
+	FStats stats;
+	//the shader hot reload builds pipelines from its own thread, the hit detection needs one creation at a time
+	std::mutex createMutex;
+
+public:
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, const char* path);
+	//saves the cache on disk before destroying it
+	void destroy();
+
+	bool save();
+
+	VkResult createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& pipelineInfo, VkPipeline* pipeline);
+
+	VkPipelineCache getHandle() const { return cache; }
+	bool isWarm() const { return loadedFromDisk; }
+	const FStats& getStats() const { return stats; }
+
+	void printStats() const;
+
+private:
+	std::vector<char> load();
+	bool isBlobCompatible(const std::vector<char>& blob) const;
+
+	size_t queryDataSize() const;
+};
@@ -0,0 +1,705 @@
+#include "PipelineManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "FileIO.h"
+
+constexpr const char* cpipelineListHeader = "pipelines 1";
+
+static void hashCombine(size_t& seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+//fnv-1a over the words, the id of a shader
+static uint64_t hashSpirv(const FSpirvView& spirv)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	for(size_t i = 0; i < spirv.size / sizeof(uint32_t); i++)
+	{
+		hash ^= spirv.code[i];
+		hash *= 1099511628211ull;
+	}
+
+	//0 means no shader
+	return hash == 0 ? 1 : hash;
+}
+
+void FGraphicsPipelineState::setVertexLayout(const VertexLayout& layout)
+{
+	vertexBindings = { layout.getBindingDescription() };
+	vertexAttributes = layout.getAttributeDescriptions();
+}
+
+void FGraphicsPipelineState::addVertexLayout(const VertexLayout& layout)
+{
+	vertexBindings.push_back(layout.getBindingDescription());
+	vertexAttributes.insert(vertexAttributes.end(), layout.getAttributeDescriptions().begin(), layout.getAttributeDescriptions().end());
+}
+
+size_t FGraphicsPipelineState::hash() const
+{
+	size_t seed = 0;
+
+	hashCombine(seed, std::hash<uint64_t>()(vertexShader));
+	hashCombine(seed, std::hash<uint64_t>()(fragmentShader));
+
+	for(const VkVertexInputBindingDescription& binding : vertexBindings)
+	{
+		hashCombine(seed, binding.binding);
+		hashCombine(seed, binding.stride);
+		hashCombine(seed, binding.inputRate);
+	}
+
+	for(const VkVertexInputAttributeDescription& attribute : vertexAttributes)
+	{
+		hashCombine(seed, attribute.location);
+		hashCombine(seed, attribute.binding);
+		hashCombine(seed, attribute.format);
+		hashCombine(seed, attribute.offset);
+	}
+
+	hashCombine(seed, topology);
+	hashCombine(seed, polygonMode);
+	hashCombine(seed, cullMode);
+	hashCombine(seed, frontFace);
+
+	hashCombine(seed, blendEnable);
+
+	//the factors mean nothing without blending, two states only differing by them are the same pipeline
+	if(blendEnable)
+	{
+		hashCombine(seed, srcColorBlend);
+		hashCombine(seed, dstColorBlend);
+		hashCombine(seed, colorBlendOp);
+		hashCombine(seed, srcAlphaBlend);
+		hashCombine(seed, dstAlphaBlend);
+		hashCombine(seed, alphaBlendOp);
+	}
+
+	hashCombine(seed, depthTest);
+	hashCombine(seed, depthWrite);
+	hashCombine(seed, depthCompare);
+
+	hashCombine(seed, colorFormat);
+	hashCombine(seed, depthFormat);
+	hashCombine(seed, samples);
+	hashCombine(seed, subpass);
+
+	for(const FSpecConstant& constant : specConstants)
+	{
+		hashCombine(seed, constant.constantID);
+		hashCombine(seed, constant.value);
+	}
+
+	return seed;
+}
+
+bool FGraphicsPipelineState::operator==(const FGraphicsPipelineState& other) const
+{
+	auto bindingsEqual = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b)
+	{
+		return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate;
+	};
+
+	auto attributesEqual = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b)
+	{
+		return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+	};
+
+	auto constantsEqual = [](const FSpecConstant& a, const FSpecConstant& b)
+	{
+		return a.constantID == b.constantID && a.value == b.value;
+	};
+
+	if (vertexShader != other.vertexShader || fragmentShader != other.fragmentShader)
+		return false;
+
+	if (!std::equal(vertexBindings.begin(), vertexBindings.end(), other.vertexBindings.begin(), other.vertexBindings.end(), bindingsEqual)
+		|| !std::equal(vertexAttributes.begin(), vertexAttributes.end(), other.vertexAttributes.begin(), other.vertexAttributes.end(), attributesEqual)
+		|| !std::equal(specConstants.begin(), specConstants.end(), other.specConstants.begin(), other.specConstants.end(), constantsEqual))
+		return false;
+
+	if (topology != other.topology || polygonMode != other.polygonMode || cullMode != other.cullMode || frontFace != other.frontFace)
+		return false;
+
+	if (blendEnable != other.blendEnable)
+		return false;
+
+	if (blendEnable && (srcColorBlend != other.srcColorBlend || dstColorBlend != other.dstColorBlend || colorBlendOp != other.colorBlendOp
+		|| srcAlphaBlend != other.srcAlphaBlend || dstAlphaBlend != other.dstAlphaBlend || alphaBlendOp != other.alphaBlendOp))
+		return false;
+
+	return depthTest == other.depthTest && depthWrite == other.depthWrite && depthCompare == other.depthCompare
+		&& colorFormat == other.colorFormat && depthFormat == other.depthFormat
+		&& samples == other.samples && subpass == other.subpass;
+}
+
+void PipelineManager::init(VkDevice device, PipelineCache& pipelineCache, LayoutCache& layoutCache, VkDescriptorSetLayout bindlessLayout, const char* listPath)
+{
+	this->device = device;
+	this->pipelineCache = &pipelineCache;
+	this->layoutCache = &layoutCache;
+	this->bindlessLayout = bindlessLayout;
+	this->listPath = listPath;
+}
+
+void PipelineManager::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+		return;
+
+	saveList();
+	printStats();
+
+	for (auto& entry : pipelines)
+		vkDestroyPipeline(device, entry.second.pipeline, nullptr);
+
+	for (auto& entry : shaders)
+		vkDestroyShaderModule(device, entry.second.module, nullptr);
+
+	pipelines.clear();
+	shaders.clear();
+	currentShaders.clear();
+	skippedLines.clear();
+
+	device = VK_NULL_HANDLE;
+}
+
+uint64_t PipelineManager::registerShader(const char* path)
+{
+	MappedFile file;
+	FSpirvView spirv = mapSpirv(path, file);
+
+	if (!spirv.isValid())
+		return 0;
+
+	uint64_t id = hashSpirv(spirv);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	currentShaders[path] = id;
+
+	if (shaders.count(id) != 0)
+		return id;
+
+	FShader shader;
+	shader.path = path;
+
+	if(!reflectSpirv(spirv, shader.reflection))
+	{
+		std::cout << "Unable to reflect " << path << std::endl;
+		currentShaders.erase(path);
+		return 0;
+	}
+
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = spirv.size;
+	createInfo.pCode = spirv.code;
+
+	if(vkCreateShaderModule(device, &createInfo, nullptr, &shader.module) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the shader module of " << path << std::endl;
+		currentShaders.erase(path);
+		return 0;
+	}
+
+	shaders.emplace(id, std::move(shader));
+
+	return id;
+}
+
+VkPipeline PipelineManager::getPipeline(const FGraphicsPipelineState& state, VkRenderPass renderPass, VkPipelineLayout* layout)
+{
+	size_t hash = state.hash();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto range = pipelines.equal_range(hash);
+
+		for(auto it = range.first; it != range.second; ++it)
+		{
+			if(it->second.state == state)
+			{
+				stats.hits++;
+
+				if (layout)
+					*layout = it->second.layout;
+
+				return it->second.pipeline;
+			}
+		}
+	}
+
+	//compiled without the lock, this can take a while
+	VkPipelineLayout createdLayout = VK_NULL_HANDLE;
+	VkPipeline created = createPipeline(state, renderPass, createdLayout);
+
+	if (created == VK_NULL_HANDLE)
+		return VK_NULL_HANDLE;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	//another thread made the same state meanwhile, its pipeline is kept so the handles stay shared
+	auto range = pipelines.equal_range(hash);
+
+	for(auto it = range.first; it != range.second; ++it)
+	{
+		if(it->second.state == state)
+		{
+			vkDestroyPipeline(device, created, nullptr);
+
+			if (layout)
+				*layout = it->second.layout;
+
+			return it->second.pipeline;
+		}
+	}
+
+	pipelines.emplace(hash, FPipelineEntry{ state, created, createdLayout });
+
+	if (layout)
+		*layout = createdLayout;
+
+	return created;
+}
+
+VkPipeline PipelineManager::createPipeline(const FGraphicsPipelineState& state, VkRenderPass renderPass, VkPipelineLayout& layout)
+{
+	FShader vertexShader;
+	FShader fragmentShader;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto vertex = shaders.find(state.vertexShader);
+		auto fragment = shaders.find(state.fragmentShader);
+
+		if(vertex == shaders.end() || fragment == shaders.end())
+		{
+			std::cout << "The pipeline state uses a shader that was never registered" << std::endl;
+			return VK_NULL_HANDLE;
+		}
+
+		//copied, retire can erase the entries while this compiles
+		//their modules go through the deletion queue, so they outlive the compilation
+		vertexShader = vertex->second;
+		fragmentShader = fragment->second;
+	}
+
+	layout = createLayout(vertexShader, fragmentShader, state);
+
+	if (layout == VK_NULL_HANDLE)
+		return VK_NULL_HANDLE;
+
+	std::vector<VkSpecializationMapEntry> specEntries;
+	specEntries.reserve(state.specConstants.size());
+
+	for(const FSpecConstant& constant : state.specConstants)
+	{
+		uint32_t offset = static_cast<uint32_t>(specEntries.size() * sizeof(uint32_t));
+		specEntries.push_back({ constant.constantID, offset, sizeof(uint32_t) });
+	}
+
+	std::vector<uint32_t> specData;
+	specData.reserve(state.specConstants.size());
+
+	for (const FSpecConstant& constant : state.specConstants)
+		specData.push_back(constant.value);
+
+	//used to tell constant values, useful for letting the compiler optimize things
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specEntries.size());
+	specializationInfo.pMapEntries = specEntries.data();
+	specializationInfo.dataSize = specData.size() * sizeof(uint32_t);
+	specializationInfo.pData = specData.data();
+
+	VkPipelineShaderStageCreateInfo createVertexStageInfo{};
+	createVertexStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createVertexStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	createVertexStageInfo.module = vertexShader.module;
+	createVertexStageInfo.pName = vertexShader.reflection.entryPoint.c_str();
+	createVertexStageInfo.pSpecializationInfo = specEntries.empty() ? nullptr : &specializationInfo;
+
+	VkPipelineShaderStageCreateInfo createFragStageInfo{};
+	createFragStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	createFragStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	createFragStageInfo.module = fragmentShader.module;
+	createFragStageInfo.pName = fragmentShader.reflection.entryPoint.c_str();
+	createFragStageInfo.pSpecializationInfo = createVertexStageInfo.pSpecializationInfo;
+
+	VkPipelineShaderStageCreateInfo shaderStages[] = { createVertexStageInfo, createFragStageInfo };
+
+	//specifies the input of the vertex pipeline pass
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(state.vertexBindings.size());
+	vertexInputInfo.pVertexBindingDescriptions = state.vertexBindings.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.vertexAttributes.size());
+	vertexInputInfo.pVertexAttributeDescriptions = state.vertexAttributes.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = state.topology;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	//the viewport and scissor are dynamic, they are set when recording the commands
+	//so resizing the window doesn't need a new pipeline
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.scissorCount = 1;
+	viewportState.viewportCount = 1;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkPipelineRasterizationStateCreateInfo rasterizer{};
+	rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizer.depthClampEnable = VK_FALSE;
+	rasterizer.rasterizerDiscardEnable = VK_FALSE;
+	rasterizer.polygonMode = state.polygonMode;
+	rasterizer.lineWidth = 1.0f;
+	rasterizer.cullMode = state.cullMode;
+	rasterizer.frontFace = state.frontFace;
+	rasterizer.depthBiasEnable = VK_FALSE;
+
+	VkPipelineMultisampleStateCreateInfo multisampling{};
+	multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampling.sampleShadingEnable = VK_FALSE;
+	multisampling.rasterizationSamples = state.samples;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencil{};
+	depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencil.depthTestEnable = state.depthTest ? VK_TRUE : VK_FALSE;
+	depthStencil.depthWriteEnable = state.depthWrite ? VK_TRUE : VK_FALSE;
+	depthStencil.depthCompareOp = state.depthCompare;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.blendEnable = state.blendEnable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = state.srcColorBlend;
+	colorBlendAttachment.dstColorBlendFactor = state.dstColorBlend;
+	colorBlendAttachment.colorBlendOp = state.colorBlendOp;
+	colorBlendAttachment.srcAlphaBlendFactor = state.srcAlphaBlend;
+	colorBlendAttachment.dstAlphaBlendFactor = state.dstAlphaBlend;
+	colorBlendAttachment.alphaBlendOp = state.alphaBlendOp;
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_A_BIT | VK_COLOR_COMPONENT_B_BIT
+	| VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_R_BIT;
+
+	VkPipelineColorBlendStateCreateInfo colorBlending{};
+	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlending.logicOpEnable = VK_FALSE;
+	colorBlending.attachmentCount = 1;
+	colorBlending.pAttachments = &colorBlendAttachment;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineInfo.stageCount = 2;
+	pipelineInfo.pStages = shaderStages;
+
+	pipelineInfo.pVertexInputState = &vertexInputInfo;
+	pipelineInfo.pInputAssemblyState = &inputAssembly;
+	pipelineInfo.pViewportState = &viewportState;
+	pipelineInfo.pRasterizationState = &rasterizer;
+	pipelineInfo.pMultisampleState = &multisampling;
+	pipelineInfo.pDepthStencilState = state.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencil : nullptr;
+	pipelineInfo.pColorBlendState = &colorBlending;
+	pipelineInfo.pDynamicState = &dynamicState;
+
+	pipelineInfo.layout = layout;
+
+	pipelineInfo.renderPass = renderPass;
+	pipelineInfo.subpass = state.subpass;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	if(pipelineCache->createGraphicsPipeline(pipelineInfo, &pipeline) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the pipeline of " << vertexShader.path << " and " << fragmentShader.path << std::endl;
+		return VK_NULL_HANDLE;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.created++;
+	stats.createMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+	return pipeline;
+}
+
+VkPipelineLayout PipelineManager::createLayout(const FShader& vertexShader, const FShader& fragmentShader, const FGraphicsPipelineState& state)
+{
+	//the vertex buffers are laid out by the state, a shader asking for something else would read garbage
+	for(const FReflectedVertexInput& input : vertexShader.reflection.vertexInputs)
+	{
+		auto attribute = std::find_if(state.vertexAttributes.begin(), state.vertexAttributes.end(),
+			[&](const VkVertexInputAttributeDescription& description) { return description.location == input.location; });
+
+		if (attribute == state.vertexAttributes.end())
+			std::cout << vertexShader.path << " reads " << input.name << " at location " << input.location << ", the vertex layout has nothing there" << std::endl;
+		else if (attribute->format != input.format)
+			std::cout << vertexShader.path << " reads " << input.name << " at location " << input.location << " in another format than the vertex layout" << std::endl;
+	}
+
+	//owned by the layout cache, pipelines with the same resources share it
+	return layoutCache->getPipelineLayout(mergeReflections({ &vertexShader.reflection, &fragmentShader.reflection }), nullptr, bindlessLayout);
+}
+
+void PipelineManager::prewarm(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples)
+{
+	std::ifstream file(listPath);
+
+	if (!file.is_open())
+		return;
+
+	std::string line;
+
+	if(!std::getline(file, line) || line != cpipelineListHeader)
+	{
+		std::cout << "Ignoring the pipeline list in " << listPath << ", it was written by another version" << std::endl;
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	uint32_t count = 0;
+	uint32_t skipped = 0;
+
+	while(std::getline(file, line))
+	{
+		std::istringstream stream(line);
+
+		std::string vertexPath, fragmentPath;
+		FGraphicsPipelineState state;
+		uint32_t topology, polygonMode, frontFace, srcColor, dstColor, colorOp, srcAlpha, dstAlpha, alphaOp;
+		uint32_t depthCompare, colorFormat, depthFormat, samples;
+		uint32_t bindingCount, attributeCount, constantCount;
+
+		stream >> std::quoted(vertexPath) >> std::quoted(fragmentPath)
+			>> topology >> polygonMode >> state.cullMode >> frontFace
+			>> state.blendEnable >> srcColor >> dstColor >> colorOp >> srcAlpha >> dstAlpha >> alphaOp
+			>> state.depthTest >> state.depthWrite >> depthCompare
+			>> colorFormat >> depthFormat >> samples >> state.subpass;
+
+		state.topology = static_cast<VkPrimitiveTopology>(topology);
+		state.polygonMode = static_cast<VkPolygonMode>(polygonMode);
+		state.frontFace = static_cast<VkFrontFace>(frontFace);
+		state.srcColorBlend = static_cast<VkBlendFactor>(srcColor);
+		state.dstColorBlend = static_cast<VkBlendFactor>(dstColor);
+		state.colorBlendOp = static_cast<VkBlendOp>(colorOp);
+		state.srcAlphaBlend = static_cast<VkBlendFactor>(srcAlpha);
+		state.dstAlphaBlend = static_cast<VkBlendFactor>(dstAlpha);
+		state.alphaBlendOp = static_cast<VkBlendOp>(alphaOp);
+		state.depthCompare = static_cast<VkCompareOp>(depthCompare);
+		state.colorFormat = static_cast<VkFormat>(colorFormat);
+		state.depthFormat = static_cast<VkFormat>(depthFormat);
+		state.samples = static_cast<VkSampleCountFlagBits>(samples);
+
+		if(stream >> bindingCount)
+		{
+			state.vertexBindings.resize(bindingCount);
+
+			for(VkVertexInputBindingDescription& binding : state.vertexBindings)
+			{
+				uint32_t inputRate;
+				stream >> binding.binding >> binding.stride >> inputRate;
+				binding.inputRate = static_cast<VkVertexInputRate>(inputRate);
+			}
+		}
+
+		if(stream >> attributeCount)
+		{
+			state.vertexAttributes.resize(attributeCount);
+
+			for(VkVertexInputAttributeDescription& attribute : state.vertexAttributes)
+			{
+				uint32_t format;
+				stream >> attribute.location >> attribute.binding >> format >> attribute.offset;
+				attribute.format = static_cast<VkFormat>(format);
+			}
+		}
+
+		if(stream >> constantCount)
+		{
+			state.specConstants.resize(constantCount);
+
+			for (FSpecConstant& constant : state.specConstants)
+				stream >> constant.constantID >> constant.value;
+		}
+
+		if (stream.fail())
+		{
+			std::cout << "Skipping a malformed line of " << listPath << std::endl;
+			continue;
+		}
+
+		//built against renderPass it would be cached under formats it doesn't match
+		if(state.colorFormat != colorFormat || state.depthFormat != depthFormat || state.samples != samples)
+		{
+			skippedLines.push_back(line);
+			skipped++;
+			continue;
+		}
+
+		//the shaders are the ones on disk now, if they changed since the list was written this still compiles what the app will ask for
+		state.vertexShader = registerShader(vertexPath.c_str());
+		state.fragmentShader = registerShader(fragmentPath.c_str());
+
+		if (state.vertexShader == 0 || state.fragmentShader == 0)
+			continue;
+
+		if (getPipeline(state, renderPass) != VK_NULL_HANDLE)
+			count++;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	stats.prewarmed += count;
+
+	std::cout << "Prewarmed " << count << " pipelines from " << listPath << " in "
+		<< std::chrono::duration<double, std::milli>(end - start).count() << " ms, "
+		<< skipped << " skipped for another render pass" << std::endl;
+}
+
+bool PipelineManager::saveList()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::ofstream file(listPath, std::ios::trunc);
+
+	if(!file.is_open())
+	{
+		std::cout << "failed to open " << listPath << " to save the pipeline list" << std::endl;
+		return false;
+	}
+
+	file << cpipelineListHeader << "\n";
+
+	uint32_t count = 0;
+
+	for(const auto& entry : pipelines)
+	{
+		const FGraphicsPipelineState& state = entry.second.state;
+
+		auto vertex = shaders.find(state.vertexShader);
+		auto fragment = shaders.find(state.fragmentShader);
+
+		//compiled by another thread after retire dropped its shaders, never asked for again either
+		if (vertex == shaders.end() || fragment == shaders.end())
+			continue;
+
+		const FShader& vertexShader = vertex->second;
+		const FShader& fragmentShader = fragment->second;
+
+		//pipelines of a shader that was edited since are never asked for again
+		if (currentShaders[vertexShader.path] != state.vertexShader || currentShaders[fragmentShader.path] != state.fragmentShader)
+			continue;
+
+		file << std::quoted(vertexShader.path) << " " << std::quoted(fragmentShader.path)
+			<< " " << state.topology << " " << state.polygonMode << " " << state.cullMode << " " << state.frontFace
+			<< " " << state.blendEnable << " " << state.srcColorBlend << " " << state.dstColorBlend << " " << state.colorBlendOp
+			<< " " << state.srcAlphaBlend << " " << state.dstAlphaBlend << " " << state.alphaBlendOp
+			<< " " << state.depthTest << " " << state.depthWrite << " " << state.depthCompare
+			<< " " << state.colorFormat << " " << state.depthFormat << " " << state.samples << " " << state.subpass;
+
+		file << " " << state.vertexBindings.size();
+
+		for (const VkVertexInputBindingDescription& binding : state.vertexBindings)
+			file << " " << binding.binding << " " << binding.stride << " " << binding.inputRate;
+
+		file << " " << state.vertexAttributes.size();
+
+		for (const VkVertexInputAttributeDescription& attribute : state.vertexAttributes)
+			file << " " << attribute.location << " " << attribute.binding << " " << attribute.format << " " << attribute.offset;
+
+		file << " " << state.specConstants.size();
+
+		for (const FSpecConstant& constant : state.specConstants)
+			file << " " << constant.constantID << " " << constant.value;
+
+		file << "\n";
+		count++;
+	}
+
+	for (const std::string& line : skippedLines)
+		file << line << "\n";
+
+	std::cout << "Saved " << count << " pipeline states to " << listPath << ", kept " << skippedLines.size() << " of another render pass" << std::endl;
+
+	return file.good();
+}
+
+void PipelineManager::retire(const std::vector<VkPipeline>& retired, DeletionQueue& deletionQueue, uint64_t frame)
+{
+	std::vector<VkPipeline> pipelinesToDestroy;
+	std::vector<VkShaderModule> modulesToDestroy;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for(auto it = pipelines.begin(); it != pipelines.end();)
+		{
+			if(std::find(retired.begin(), retired.end(), it->second.pipeline) != retired.end())
+			{
+				pipelinesToDestroy.push_back(it->second.pipeline);
+				it = pipelines.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		for(auto it = shaders.begin(); it != shaders.end();)
+		{
+			uint64_t id = it->first;
+
+			bool current = currentShaders[it->second.path] == id;
+			bool used = std::any_of(pipelines.begin(), pipelines.end(), [id](const auto& entry)
+			{
+				return entry.second.state.vertexShader == id || entry.second.state.fragmentShader == id;
+			});
+
+			if(!current && !used)
+			{
+				modulesToDestroy.push_back(it->second.module);
+				it = shaders.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	if (pipelinesToDestroy.empty() && modulesToDestroy.empty())
+		return;
+
+	deletionQueue.push(frame, [device = device, pipelinesToDestroy, modulesToDestroy]()
+	{
+		for (VkPipeline pipeline : pipelinesToDestroy)
+			vkDestroyPipeline(device, pipeline, nullptr);
+
+		for (VkShaderModule module : modulesToDestroy)
+			vkDestroyShaderModule(device, module, nullptr);
+	});
+}
+
+void PipelineManager::printStats() const
+{
+	std::cout << "Pipeline manager: " << stats.created << " pipelines created (" << stats.createMs << " ms, "
+		<< stats.prewarmed << " prewarmed), " << stats.hits << " lookups shared an existing one" << std::endl;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DeletionQueue.h"
+#include "LayoutCache.h"
+#include "PipelineCache.h"
+#include "SpirvReflection.h"
+#include "VertexLayout.h"
+
+struct FSpecConstant
+{
+	uint32_t constantID;
+	//every constant is given as 32 bits, bools included
+	uint32_t value;
+};
+
+//everything that goes into a graphics pipeline, two equal states always give the same pipeline
+//the shaders are the ids given by PipelineManager::registerShader, so a shader edited on disk is another state
+//the render pass isn't part of it, the formats are: a pipeline can be used with any compatible render pass
+struct FGraphicsPipelineState
+{
+	uint64_t vertexShader = 0;
+	uint64_t fragmentShader = 0;
+
+	std::vector<VkVertexInputBindingDescription> vertexBindings;
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	bool blendEnable = false;
+	VkBlendFactor srcColorBlend = VK_BLEND_FACTOR_SRC_ALPHA;
+	VkBlendFactor dstColorBlend = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+	VkBlendFactor srcAlphaBlend = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstAlphaBlend = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+
+	bool depthTest = false;
+	bool depthWrite = false;
+	VkCompareOp depthCompare = VK_COMPARE_OP_LESS;
+
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	uint32_t subpass = 0;
+
+	//given to both stages, a constant a stage doesn't declare is ignored by it
+	std::vector<FSpecConstant> specConstants;
+
+	void setVertexLayout(const VertexLayout& layout);
+	//another binding, a per instance stream...
+	void addVertexLayout(const VertexLayout& layout);
+
+	size_t hash() const;
+	bool operator==(const FGraphicsPipelineState& other) const;
+};
+
+//owns every graphics pipeline of the app, they are made the first time their state is asked for and then shared
+//so hundreds of permutations asking for the same state only compile it once
+//the states made during a run are written in a list on destroy, the next run compiles them all at startup with prewarm
+//instead of stalling on the first frame that needs them
+class PipelineManager
+{
+	struct FShader
+	{
+		std::string path;
+		VkShaderModule module;
+		FShaderReflection reflection;
+	};
+
+	struct FPipelineEntry
+	{
+		FGraphicsPipelineState state;
+		VkPipeline pipeline;
+		VkPipelineLayout layout;
+	};
+
+public:
+	struct FStats
+	{
+		uint32_t hits = 0;
+		uint32_t created = 0;
+		uint32_t prewarmed = 0;
+		double createMs = 0.0;
+	};
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	PipelineCache* pipelineCache = nullptr;
+	LayoutCache* layoutCache = nullptr;
+	//at cbindlessSet in every layout when there is a bindless heap
+	VkDescriptorSetLayout bindlessLayout = VK_NULL_HANDLE;
+
+	std::string listPath;
+
+	//keyed by the hash of their spir-v, an edited shader gets a new entry and the old pipelines stay valid until retired
+	std::unordered_map<uint64_t, FShader> shaders;
+	//the last id registered for each path, only these end up in the list
+	std::unordered_map<std::string, uint64_t> currentShaders;
+
+	std::unordered_multimap<size_t, FPipelineEntry> pipelines;
+
+	//the lines prewarm skipped, written back by saveList so a headless run doesn't drop the windowed states
+	std::vector<std::string> skippedLines;
+
+	//the shader hot reload asks for pipelines from its own thread
+	//it isn't held while compiling, the render thread can still find the pipelines that exist
+	std::mutex mutex;
+
+	FStats stats;
+
+public:
+	//bindlessLayout can be VK_NULL_HANDLE, the layouts only have the sets of the shaders then
+	void init(VkDevice device, PipelineCache& pipelineCache, LayoutCache& layoutCache, VkDescriptorSetLayout bindlessLayout, const char* listPath);
+	//writes the list of the states made during the run, then destroys the pipelines and the shader modules
+	void destroy();
+
+	//maps the spir-v at path and returns its id for FGraphicsPipelineState, 0 if it can't be loaded
+	//registering the same path again after it changed on disk gives a new id
+	uint64_t registerShader(const char* path);
+
+	//the cached pipeline for state, compiled now if it was never asked for, VK_NULL_HANDLE if it doesn't build
+	//layout gets the pipeline layout, made from the reflection of the shaders
+	VkPipeline getPipeline(const FGraphicsPipelineState& state, VkRenderPass renderPass, VkPipelineLayout* layout = nullptr);
+
+	//compiles the states of the list written by the last run that renderPass is compatible with
+	//the formats and samples are the ones of renderPass, states recorded with others (the headless runs...) are skipped
+	void prewarm(VkRenderPass renderPass, VkFormat colorFormat, VkFormat depthFormat = VK_FORMAT_UNDEFINED,
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+	bool saveList();
+
+	//takes the pipelines out of the cache, they are destroyed by deletionQueue once the frames submitted before frame are done
+	//the modules of the shaders replaced on disk go with them once no cached pipeline uses them anymore
+	//the render thread only, like the deletion queue
+	void retire(const std::vector<VkPipeline>& retired, DeletionQueue& deletionQueue, uint64_t frame);
+
+	const FStats& getStats() const { return stats; }
+	void printStats() const;
+
+private:
+	VkPipeline createPipeline(const FGraphicsPipelineState& state, VkRenderPass renderPass, VkPipelineLayout& layout);
+	VkPipelineLayout createLayout(const FShader& vertexShader, const FShader& fragmentShader, const FGraphicsPipelineState& state);
+};
@@ -0,0 +1,146 @@
+#include "ShaderHotReload.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+constexpr std::chrono::milliseconds cpollInterval(250);
+
+void ShaderHotReload::init(const std::vector<FShaderSource>& sources, std::function<void()>&& onRecompiled)
+{
+	this->onRecompiled = std::move(onRecompiled);
+	compilerPath = findCompiler();
+	stopping = false;
+
+	std::error_code error;
+
+	for(const FShaderSource& source : sources)
+	{
+		FWatchedShader shader{ source, std::filesystem::last_write_time(source.source, error) };
+
+		if(error)
+		{
+			std::cout << "Not watching " << source.source << ", it can't be found" << std::endl;
+			continue;
+		}
+
+		shaders.push_back(shader);
+	}
+
+	if (shaders.empty())
+		return;
+
+	watcher = std::thread(&ShaderHotReload::watchLoop, this);
+
+	std::cout << "Watching " << shaders.size() << " shaders, recompiled with " << compilerPath << std::endl;
+}
+
+void ShaderHotReload::destroy()
+{
+	if (!watcher.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wakeCondition.notify_all();
+	watcher.join();
+
+	shaders.clear();
+}
+
+void ShaderHotReload::watchLoop()
+{
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait_for(lock, cpollInterval, [this]() { return stopping; });
+
+			if (stopping)
+				return;
+		}
+
+		bool recompiled = false;
+
+		for(FWatchedShader& shader : shaders)
+		{
+			std::error_code error;
+			std::filesystem::file_time_type lastWrite = std::filesystem::last_write_time(shader.paths.source, error);
+
+			//editors that save by replacing the file make it disappear for a moment
+			if (error || lastWrite == shader.lastWrite)
+				continue;
+
+			shader.lastWrite = lastWrite;
+
+			//a failed compile keeps the old spir-v, fixing the error triggers the next try
+			if (compile(shader.paths))
+				recompiled = true;
+		}
+
+		if (recompiled && onRecompiled)
+			onRecompiled();
+	}
+}
+
+bool ShaderHotReload::compile(const FShaderSource& shader)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	//compiled next to the output then renamed, the render thread never reads a half written file
+	std::string temporary = shader.output + ".tmp";
+	std::string command = "\"" + compilerPath + "\" \"" + shader.source + "\" -o \"" + temporary + "\"";
+
+#ifdef _WIN32
+	//cmd strips the first and last quotes of the line
+	command = "\"" + command + "\"";
+#endif
+
+	std::cout << "Recompiling " << shader.source << std::endl;
+
+	if(std::system(command.c_str()) != 0)
+	{
+		std::cout << "Compiling " << shader.source << " failed, keeping the previous version" << std::endl;
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, shader.output, error);
+
+	if(error)
+	{
+		std::cout << "Unable to replace " << shader.output << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << "Recompiled " << shader.source << " in " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+	return true;
+}
+
+std::string ShaderHotReload::findCompiler()
+{
+	const char* sdk = std::getenv("VULKAN_SDK");
+
+	if(sdk != nullptr)
+	{
+		//Bin on windows, bin elsewhere
+		for(const char* directory : { "Bin", "bin" })
+		{
+			for(const char* executable : { "glslc.exe", "glslc" })
+			{
+				std::filesystem::path candidate = std::filesystem::path(sdk) / directory / executable;
+
+				std::error_code error;
+				if (std::filesystem::exists(candidate, error))
+					return candidate.string();
+			}
+		}
+	}
+
+	return "glslc";
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//watches the glsl sources of the shaders and recompiles the ones that changed with glslc, on its own thread
+//the sources are polled, a few stat calls every so often work the same everywhere
+//onRecompiled runs on the watcher thread too, so whatever is built from the new spir-v stays off the render thread
+class ShaderHotReload
+{
+public:
+	struct FShaderSource
+	{
+		std::string source;
+		//where compileShaders.bat puts it, the pipelines are read from there
+		std::string output;
+	};
+
+private:
+	struct FWatchedShader
+	{
+		FShaderSource paths;
+		std::filesystem::file_time_type lastWrite;
+	};
+
+	std::vector<FWatchedShader> shaders;
+	std::string compilerPath;
+	std::function<void()> onRecompiled;
+
+	std::thread watcher;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	bool stopping = false;
+
+public:
+	void init(const std::vector<FShaderSource>& sources, std::function<void()>&& onRecompiled);
+	void destroy();
+
+	bool isRunning() const { return watcher.joinable(); }
+
+private:
+	void watchLoop();
+	bool compile(const FShaderSource& shader);
+
+	//glslc of the vulkan sdk when VULKAN_SDK is set, the one on the path otherwise
+	static std::string findCompiler();
+};
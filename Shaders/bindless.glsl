@@ -0,0 +1,18 @@
+//the bindless heap, same set and bindings as BindlessHeap.h
+//#include it and index the arrays with the handles given by the push constants or the per draw data
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define BINDLESS_SET 0
+
+layout(set = BINDLESS_SET, binding = 0) uniform texture2D bindlessImages[];
+layout(set = BINDLESS_SET, binding = 2) uniform sampler bindlessSamplers[];
+
+//storage buffers can't be declared without a block, so each kind of buffer declares its own array on binding 1
+//variadic, the commas of the block's members would split it into more arguments
+#define BINDLESS_BUFFER(Name, ...) layout(std430, set = BINDLESS_SET, binding = 1) readonly buffer Name __VA_ARGS__ bindless##Name[]
+
+//nonuniformEXT in case the handles differ inside a draw
+vec4 sampleBindless(uint image, uint samplerHandle, vec2 uv)
+{
+	return texture(sampler2D(bindlessImages[nonuniformEXT(image)], bindlessSamplers[nonuniformEXT(samplerHandle)]), uv);
+}
@@ -1,3 +1,7 @@
 C:\VulkanSDK\1.2.154.1\Bin\glslc.exe vertex.vert -o vert.spv
 C:\VulkanSDK\1.2.154.1\Bin\glslc.exe frag.frag -o frag.spv
+C:\VulkanSDK\1.2.154.1\Bin\glslc.exe particles.comp -o particles.spv
+C:\VulkanSDK\1.2.154.1\Bin\glslc.exe instanced.vert -o instanced.spv
+C:\VulkanSDK\1.2.154.1\Bin\glslc.exe cull.comp -o cull.spv
+C:\VulkanSDK\1.2.154.1\Bin\glslc.exe objects.vert -o objects.spv
 pause
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+//per instance, the first 3 rows of the transform
+layout(location = 2) in vec4 inTransformRow0;
+layout(location = 3) in vec4 inTransformRow1;
+layout(location = 4) in vec4 inTransformRow2;
+
+layout(location = 0) out vec3 color;
+
+void main() {
+    vec4 position = vec4(inPosition, 0.0, 1.0);
+    gl_Position = vec4(dot(inTransformRow0, position), dot(inTransformRow1, position), dot(inTransformRow2, position), 1.0);
+    color = inColor;
+}
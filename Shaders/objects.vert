@@ -0,0 +1,33 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 color;
+
+struct GpuObject
+{
+    vec4 rows[3];
+    vec4 bounds;
+};
+
+//the object buffer of IndirectRenderer, registered in the heap by Application::setGpuObjects
+BINDLESS_BUFFER(Objects, { GpuObject objects[]; });
+
+layout(push_constant) uniform Push
+{
+    uint objects;
+} push;
+
+void main() {
+    //firstInstance of each indirect command is its object
+    GpuObject object = bindlessObjects[push.objects].objects[gl_InstanceIndex];
+
+    vec4 position = vec4(inPosition, 0.0, 1.0);
+    gl_Position = vec4(dot(object.rows[0], position), dot(object.rows[1], position), dot(object.rows[2], position), 1.0);
+    color = inColor;
+}
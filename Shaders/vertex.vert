@@ -1,21 +1,19 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
-
-vec3 colors[3] = vec3[](
-    vec3(1, 0, 0),
-    vec3(0, 1, 0),
-    vec3(0, 0, 1)
-);
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
 
 layout(location = 0) out vec3 color;
 
+//per draw, set 1 is made dynamic and bound at each draw's offset in the frame's transient buffer
+layout(set = 1, binding = 0) uniform Draw
+{
+    vec4 offset;
+    vec4 tint;
+} draw;
+
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    color = colors[gl_VertexIndex];
+    gl_Position = vec4(inPosition + draw.offset.xy, 0.0, 1.0);
+    color = inColor * draw.tint.rgb;
 }
\ No newline at end of file
@@ -0,0 +1,521 @@
+#include "SpirvReflection.h"
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+//from the spir-v specification, only the ones the interface needs
+enum ESpirvOp : uint16_t
+{
+	OpName = 5,
+	OpEntryPoint = 15,
+	OpTypeBool = 20,
+	OpTypeInt = 21,
+	OpTypeFloat = 22,
+	OpTypeVector = 23,
+	OpTypeMatrix = 24,
+	OpTypeImage = 25,
+	OpTypeSampler = 26,
+	OpTypeSampledImage = 27,
+	OpTypeArray = 28,
+	OpTypeRuntimeArray = 29,
+	OpTypeStruct = 30,
+	OpTypePointer = 32,
+	OpConstant = 43,
+	OpSpecConstantTrue = 48,
+	OpSpecConstantFalse = 49,
+	OpSpecConstant = 50,
+	OpVariable = 59,
+	OpDecorate = 71,
+	OpMemberDecorate = 72,
+	OpFunction = 54
+};
+
+enum ESpirvDecoration : uint32_t
+{
+	DecorationSpecId = 1,
+	DecorationBlock = 2,
+	DecorationBufferBlock = 3,
+	DecorationArrayStride = 6,
+	DecorationMatrixStride = 7,
+	DecorationBuiltIn = 11,
+	DecorationLocation = 30,
+	DecorationBinding = 33,
+	DecorationDescriptorSet = 34,
+	DecorationOffset = 35
+};
+
+enum ESpirvStorageClass : uint32_t
+{
+	StorageUniformConstant = 0,
+	StorageInput = 1,
+	StorageUniform = 2,
+	StoragePushConstant = 9,
+	StorageStorageBuffer = 12
+};
+
+constexpr uint32_t cspirvHeaderWords = 5;
+constexpr uint32_t cspirvDimBuffer = 5;
+
+namespace
+{
+	//everything known about one result id, most of it stays empty
+	struct FSpirvId
+	{
+		uint16_t opcode = 0;
+		std::string name;
+
+		//types: the component, element or pointee type, and the scalar width or the vector/array size
+		uint32_t typeId = 0;
+		uint32_t width = 0;
+		uint32_t count = 0;
+		bool isSigned = false;
+		uint32_t storageClass = 0;
+		//images
+		uint32_t dim = 0;
+		uint32_t sampled = 0;
+		//structs
+		std::vector<uint32_t> members;
+		std::vector<uint32_t> memberOffsets;
+		uint32_t arrayStride = 0;
+		uint32_t matrixStride = 0;
+
+		//constants, the low word is enough for array sizes
+		uint32_t value = 0;
+
+		//decorations
+		uint32_t set = 0;
+		uint32_t binding = UINT32_MAX;
+		uint32_t location = UINT32_MAX;
+		uint32_t specId = UINT32_MAX;
+		bool block = false;
+		bool bufferBlock = false;
+		bool builtIn = false;
+	};
+
+	std::string readString(const uint32_t* words, uint32_t wordCount)
+	{
+		const char* text = reinterpret_cast<const char*>(words);
+		size_t length = 0;
+
+		while (length < wordCount * 4 && text[length] != '\0')
+			length++;
+
+		return std::string(text, length);
+	}
+
+	VkShaderStageFlagBits getStage(uint32_t executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return VK_SHADER_STAGE_ALL;
+		}
+	}
+
+	uint32_t getTypeSize(const std::vector<FSpirvId>& ids, uint32_t typeId)
+	{
+		const FSpirvId& type = ids[typeId];
+
+		switch (type.opcode)
+		{
+		case OpTypeBool:
+			return 4;
+		case OpTypeInt:
+		case OpTypeFloat:
+			return type.width / 8;
+		case OpTypeVector:
+			return type.count * getTypeSize(ids, type.typeId);
+		case OpTypeMatrix:
+			return type.count * (type.matrixStride ? type.matrixStride : getTypeSize(ids, type.typeId));
+		case OpTypeArray:
+			return ids[type.count].value * (type.arrayStride ? type.arrayStride : getTypeSize(ids, type.typeId));
+		case OpTypeStruct:
+		{
+			//the last member ends the struct, the offsets say where it starts
+			uint32_t size = 0;
+
+			for (size_t i = 0; i < type.members.size(); i++)
+			{
+				uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+				size = std::max(size, offset + getTypeSize(ids, type.members[i]));
+			}
+
+			return size;
+		}
+		default:
+			return 0;
+		}
+	}
+
+	VkFormat getVertexFormat(const std::vector<FSpirvId>& ids, uint32_t typeId)
+	{
+		const FSpirvId& type = ids[typeId];
+		uint32_t components = type.opcode == OpTypeVector ? type.count : 1;
+		const FSpirvId& scalar = type.opcode == OpTypeVector ? ids[type.typeId] : type;
+
+		if (scalar.width != 32)
+			return VK_FORMAT_UNDEFINED;
+
+		const VkFormat floats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		const VkFormat ints[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		const VkFormat uints[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (components < 1 || components > 4)
+			return VK_FORMAT_UNDEFINED;
+
+		if (scalar.opcode == OpTypeFloat)
+			return floats[components - 1];
+		if (scalar.opcode == OpTypeInt)
+			return scalar.isSigned ? ints[components - 1] : uints[components - 1];
+
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	//false for the variables that are not descriptors
+	bool getDescriptorType(const std::vector<FSpirvId>& ids, const FSpirvId& pointer, uint32_t typeId, VkDescriptorType& descriptorType)
+	{
+		const FSpirvId& type = ids[typeId];
+
+		switch (type.opcode)
+		{
+		case OpTypeSampledImage:
+			descriptorType = ids[type.typeId].dim == cspirvDimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			return true;
+		case OpTypeImage:
+			if (type.dim == cspirvDimBuffer)
+				descriptorType = type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			else
+				descriptorType = type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			return true;
+		case OpTypeSampler:
+			descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			return true;
+		case OpTypeStruct:
+			if (pointer.storageClass == StorageStorageBuffer || type.bufferBlock)
+				descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			else if (pointer.storageClass == StorageUniform)
+				descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			else
+				return false;
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+bool reflectSpirv(const FSpirvView& spirv, FShaderReflection& reflection)
+{
+	if (!spirv.isValid())
+		return false;
+
+	const uint32_t* words = spirv.code;
+	uint32_t wordCount = static_cast<uint32_t>(spirv.size / sizeof(uint32_t));
+	uint32_t bound = words[3];
+
+	std::vector<FSpirvId> ids(bound);
+	std::vector<uint32_t> variables;
+	std::vector<uint32_t> specConstants;
+
+	bool hasEntryPoint = false;
+
+	for(uint32_t offset = cspirvHeaderWords; offset < wordCount;)
+	{
+		uint16_t opcode = words[offset] & 0xFFFF;
+		uint16_t length = words[offset] >> 16;
+
+		if(length == 0 || offset + length > wordCount)
+		{
+			std::cout << "Malformed spir-v instruction at word " << offset << std::endl;
+			return false;
+		}
+
+		const uint32_t* operands = words + offset + 1;
+		uint32_t operandCount = length - 1u;
+
+		//every id used below is checked against the bound, the words come from a file
+		auto valid = [bound](uint32_t id) { return id < bound; };
+
+		switch (opcode)
+		{
+		case OpName:
+			if (operandCount >= 1 && valid(operands[0]))
+				ids[operands[0]].name = readString(operands + 1, operandCount - 1);
+			break;
+		case OpEntryPoint:
+			//the first one, the modules here only have one
+			if(!hasEntryPoint && operandCount >= 3)
+			{
+				reflection.stage = getStage(operands[0]);
+				reflection.entryPoint = readString(operands + 2, operandCount - 2);
+				hasEntryPoint = true;
+			}
+			break;
+		case OpTypeBool:
+		case OpTypeSampler:
+			if (operandCount >= 1 && valid(operands[0]))
+				ids[operands[0]].opcode = opcode;
+			break;
+		case OpTypeInt:
+		case OpTypeFloat:
+			if(operandCount >= 2 && valid(operands[0]))
+			{
+				ids[operands[0]].opcode = opcode;
+				ids[operands[0]].width = operands[1];
+				ids[operands[0]].isSigned = opcode == OpTypeInt && operandCount >= 3 && operands[2] == 1;
+			}
+			break;
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeArray:
+			//the array's count is the id of its length constant
+			if(operandCount >= 3 && valid(operands[0]) && valid(operands[1]))
+			{
+				ids[operands[0]].opcode = opcode;
+				ids[operands[0]].typeId = operands[1];
+				ids[operands[0]].count = operands[2];
+
+				if (opcode == OpTypeArray && !valid(operands[2]))
+					return false;
+			}
+			break;
+		case OpTypeRuntimeArray:
+		case OpTypeSampledImage:
+			if(operandCount >= 2 && valid(operands[0]) && valid(operands[1]))
+			{
+				ids[operands[0]].opcode = opcode;
+				ids[operands[0]].typeId = operands[1];
+			}
+			break;
+		case OpTypeImage:
+			if(operandCount >= 7 && valid(operands[0]))
+			{
+				ids[operands[0]].opcode = opcode;
+				ids[operands[0]].dim = operands[2];
+				ids[operands[0]].sampled = operands[6];
+			}
+			break;
+		case OpTypeStruct:
+			if(operandCount >= 1 && valid(operands[0]))
+			{
+				FSpirvId& type = ids[operands[0]];
+				type.opcode = opcode;
+				type.members.assign(operands + 1, operands + operandCount);
+
+				if (!std::all_of(type.members.begin(), type.members.end(), valid))
+					return false;
+
+				type.memberOffsets.resize(type.members.size(), 0);
+			}
+			break;
+		case OpTypePointer:
+			if(operandCount >= 3 && valid(operands[0]) && valid(operands[2]))
+			{
+				ids[operands[0]].opcode = opcode;
+				ids[operands[0]].storageClass = operands[1];
+				ids[operands[0]].typeId = operands[2];
+			}
+			break;
+		case OpConstant:
+			if(operandCount >= 3 && valid(operands[1]))
+			{
+				ids[operands[1]].opcode = opcode;
+				ids[operands[1]].typeId = operands[0];
+				ids[operands[1]].value = operands[2];
+			}
+			break;
+		case OpSpecConstantTrue:
+		case OpSpecConstantFalse:
+		case OpSpecConstant:
+			if(operandCount >= 2 && valid(operands[1]) && valid(operands[0]))
+			{
+				ids[operands[1]].opcode = opcode;
+				ids[operands[1]].typeId = operands[0];
+				ids[operands[1]].value = operandCount >= 3 ? operands[2] : 0;
+				specConstants.push_back(operands[1]);
+			}
+			break;
+		case OpVariable:
+			if(operandCount >= 3 && valid(operands[0]) && valid(operands[1]))
+			{
+				ids[operands[1]].opcode = opcode;
+				ids[operands[1]].typeId = operands[0];
+				ids[operands[1]].storageClass = operands[2];
+				variables.push_back(operands[1]);
+			}
+			break;
+		case OpDecorate:
+			if(operandCount >= 2 && valid(operands[0]))
+			{
+				FSpirvId& target = ids[operands[0]];
+				uint32_t argument = operandCount >= 3 ? operands[2] : 0;
+
+				switch (operands[1])
+				{
+				case DecorationSpecId: target.specId = argument; break;
+				case DecorationBlock: target.block = true; break;
+				case DecorationBufferBlock: target.bufferBlock = true; break;
+				case DecorationArrayStride: target.arrayStride = argument; break;
+				case DecorationBuiltIn: target.builtIn = true; break;
+				case DecorationLocation: target.location = argument; break;
+				case DecorationBinding: target.binding = argument; break;
+				case DecorationDescriptorSet: target.set = argument; break;
+				default: break;
+				}
+			}
+			break;
+		case OpMemberDecorate:
+			if(operandCount >= 4 && valid(operands[0]))
+			{
+				FSpirvId& target = ids[operands[0]];
+
+				//the members are declared before their decorations, the offsets are kept aside until then
+				if (target.memberOffsets.size() <= operands[1])
+					target.memberOffsets.resize(operands[1] + 1, 0);
+
+				if (operands[2] == DecorationOffset)
+					target.memberOffsets[operands[1]] = operands[3];
+				else if (operands[2] == DecorationBuiltIn)
+					target.builtIn = true;
+				else if (operands[2] == DecorationMatrixStride && operands[1] < target.members.size() && valid(target.members[operands[1]]))
+					ids[target.members[operands[1]]].matrixStride = operands[3];
+			}
+			break;
+		default:
+			break;
+		}
+
+		//the interface is all declared before the first function
+		if (opcode == OpFunction)
+			break;
+
+		offset += length;
+	}
+
+	if(!hasEntryPoint)
+	{
+		std::cout << "The spir-v module has no entry point" << std::endl;
+		return false;
+	}
+
+	for(uint32_t variableId : variables)
+	{
+		const FSpirvId& variable = ids[variableId];
+		const FSpirvId& pointer = ids[variable.typeId];
+
+		if (pointer.opcode != OpTypePointer)
+			continue;
+
+		uint32_t typeId = pointer.typeId;
+
+		if(variable.storageClass == StoragePushConstant)
+		{
+			reflection.pushConstants.stageFlags = reflection.stage;
+			reflection.pushConstants.offset = 0;
+			reflection.pushConstants.size = getTypeSize(ids, typeId);
+			continue;
+		}
+
+		if(variable.storageClass == StorageInput)
+		{
+			//gl_VertexIndex... and the inputs of the other stages are not vertex attributes
+			if (reflection.stage != VK_SHADER_STAGE_VERTEX_BIT || variable.builtIn || ids[typeId].builtIn || variable.location == UINT32_MAX)
+				continue;
+
+			reflection.vertexInputs.push_back({ variable.location, getVertexFormat(ids, typeId), variable.name });
+			continue;
+		}
+
+		if (variable.storageClass != StorageUniform && variable.storageClass != StorageUniformConstant && variable.storageClass != StorageStorageBuffer)
+			continue;
+
+		FReflectedBinding reflected;
+		reflected.set = variable.set;
+		reflected.name = variable.name.empty() ? ids[typeId].name : variable.name;
+		reflected.binding.binding = variable.binding == UINT32_MAX ? 0 : variable.binding;
+		reflected.binding.descriptorCount = 1;
+		reflected.binding.stageFlags = reflection.stage;
+
+		//arrays of descriptors
+		if(ids[typeId].opcode == OpTypeArray)
+		{
+			reflected.binding.descriptorCount = ids[ids[typeId].count].value;
+			typeId = ids[typeId].typeId;
+		}
+		else if(ids[typeId].opcode == OpTypeRuntimeArray)
+		{
+			reflected.unbounded = true;
+			typeId = ids[typeId].typeId;
+		}
+
+		if (!getDescriptorType(ids, pointer, typeId, reflected.binding.descriptorType))
+			continue;
+
+		reflection.bindings.push_back(reflected);
+	}
+
+	for(uint32_t constantId : specConstants)
+	{
+		const FSpirvId& constant = ids[constantId];
+
+		if (constant.specId == UINT32_MAX)
+			continue;
+
+		uint32_t size = constant.opcode == OpSpecConstant ? getTypeSize(ids, constant.typeId) : sizeof(VkBool32);
+		reflection.specConstants.push_back({ constant.specId, size, constant.name });
+	}
+
+	std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(),
+		[](const FReflectedVertexInput& a, const FReflectedVertexInput& b) { return a.location < b.location; });
+
+	return true;
+}
+
+FPipelineReflection mergeReflections(const std::vector<const FShaderReflection*>& stages)
+{
+	FPipelineReflection pipeline;
+	VkPushConstantRange pushConstants{};
+
+	for(const FShaderReflection* stage : stages)
+	{
+		for(const FReflectedBinding& reflected : stage->bindings)
+		{
+			if (pipeline.sets.size() <= reflected.set)
+				pipeline.sets.resize(reflected.set + 1);
+
+			std::vector<VkDescriptorSetLayoutBinding>& set = pipeline.sets[reflected.set];
+
+			auto existing = std::find_if(set.begin(), set.end(),
+				[&](const VkDescriptorSetLayoutBinding& binding) { return binding.binding == reflected.binding.binding; });
+
+			if (existing == set.end())
+				set.push_back(reflected.binding);
+			else
+				existing->stageFlags |= reflected.binding.stageFlags;
+		}
+
+		//one range over every stage, glsl puts each block at offset 0 anyway
+		if(stage->pushConstants.size > 0)
+		{
+			pushConstants.stageFlags |= stage->pushConstants.stageFlags;
+			pushConstants.size = std::max(pushConstants.size, stage->pushConstants.size);
+		}
+	}
+
+	for(std::vector<VkDescriptorSetLayoutBinding>& set : pipeline.sets)
+	{
+		std::sort(set.begin(), set.end(),
+			[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+	}
+
+	if (pushConstants.size > 0)
+		pipeline.pushConstants.push_back(pushConstants);
+
+	return pipeline;
+}
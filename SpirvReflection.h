@@ -0,0 +1,59 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FileIO.h"
+
+//what a shader module needs from its pipeline, read from its spir-v words
+//only the parts of the format that describe the interface are parsed, the function bodies are skipped
+struct FReflectedBinding
+{
+	uint32_t set = 0;
+	VkDescriptorSetLayoutBinding binding{};
+	//runtime array, the count is only known when the set is allocated
+	bool unbounded = false;
+	std::string name;
+};
+
+struct FReflectedVertexInput
+{
+	uint32_t location = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	std::string name;
+};
+
+struct FReflectedSpecConstant
+{
+	uint32_t constantID = 0;
+	//in bytes, what the VkSpecializationMapEntry of it needs
+	uint32_t size = 0;
+	std::string name;
+};
+
+struct FShaderReflection
+{
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+	std::string entryPoint;
+
+	std::vector<FReflectedBinding> bindings;
+	//a shader has one push constant block at most, size 0 if it has none
+	VkPushConstantRange pushConstants{};
+	//vertex shaders only, sorted by location
+	std::vector<FReflectedVertexInput> vertexInputs;
+	std::vector<FReflectedSpecConstant> specConstants;
+};
+
+//the stages of a pipeline together, bindings used by several stages are merged
+struct FPipelineReflection
+{
+	//indexed by set, a set no stage uses is an empty layout
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+	std::vector<VkPushConstantRange> pushConstants;
+};
+
+//false if the words are not a spir-v module this can read
+bool reflectSpirv(const FSpirvView& spirv, FShaderReflection& reflection);
+
+FPipelineReflection mergeReflections(const std::vector<const FShaderReflection*>& stages);
@@ -0,0 +1,349 @@
+#include "StagingRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+//copies of buffers have no alignment requirement, this only keeps the uploads on cache lines
+constexpr VkDeviceSize cstagingAlignment = 64;
+
+void StagingRing::init(VkDevice device, MemoryAllocator& allocator, VkDeviceSize capacity, VkQueue transferQueue,
+	uint32_t transferFamily, uint32_t graphicsFamily, uint32_t framesInFlight, bool useTimeline)
+{
+	this->device = device;
+	this->allocator = &allocator;
+	this->transferQueue = transferQueue;
+	this->transferFamily = transferFamily;
+	this->graphicsFamily = graphicsFamily;
+
+	if(allocator.createBuffer(EMemoryPool::Staging, capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, ring) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create the staging ring" << std::endl;
+		return;
+	}
+
+	recorder.init(device, transferFamily, framesInFlight);
+	batches.resize(framesInFlight);
+
+	if (useTimeline && !timeline.init(device))
+		std::cout << "Falling back to fences for the staging ring" << std::endl;
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for(FBatch& batch : batches)
+	{
+		if (timeline.isValid())
+			continue;
+
+		if(vkCreateFence(device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS
+			|| vkCreateSemaphore(device, &semaphoreInfo, nullptr, &batch.semaphore) != VK_SUCCESS)
+		{
+			std::cout << "Unable to create the staging ring's sync objects" << std::endl;
+		}
+	}
+
+	recorder.beginFrame(0);
+
+	std::cout << "Staging ring of " << capacity / 1024 << " KiB, uploading on "
+		<< (hasDedicatedQueue() ? "a dedicated transfer queue" : "the graphics queue") << std::endl;
+}
+
+void StagingRing::destroy()
+{
+	if (ring.buffer == VK_NULL_HANDLE)
+		return;
+
+	if (timeline.isValid())
+		timeline.wait(lastTimelineValue);
+
+	for(FBatch& batch : batches)
+	{
+		if (batch.submitted && batch.fence != VK_NULL_HANDLE)
+			vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+
+		for (FBuffer& staging : batch.stagingBuffers)
+			allocator->destroyBuffer(staging);
+
+		if (batch.fence != VK_NULL_HANDLE)
+			vkDestroyFence(device, batch.fence, nullptr);
+		if (batch.semaphore != VK_NULL_HANDLE)
+			vkDestroySemaphore(device, batch.semaphore, nullptr);
+	}
+
+	timeline.destroy();
+
+	batches.clear();
+	submitOrder.clear();
+	pendingCopies.clear();
+	pendingBytes = 0;
+	pendingAcquires.clear();
+	flushedAcquires.clear();
+
+	for (FBuffer& staging : pendingStagingBuffers)
+		allocator->destroyBuffer(staging);
+
+	pendingStagingBuffers.clear();
+
+	recorder.destroy();
+	allocator->destroyBuffer(ring);
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex)
+{
+	//the pending copies aren't recorded yet, a skipped frame just leaves them for the next flush
+	FBatch& batch = batches[frameIndex];
+
+	if(batch.submitted)
+	{
+		reclaim(batch);
+		submitOrder.erase(std::find(submitOrder.begin(), submitOrder.end(), frameIndex));
+		batch.submitted = false;
+	}
+
+	currentBatch = frameIndex;
+	recorder.beginFrame(frameIndex);
+}
+
+bool StagingRing::upload(const void* data, VkDeviceSize size, VkBuffer dst, VkDeviceSize dstOffset,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	if (ring.buffer == VK_NULL_HANDLE || size == 0)
+		return false;
+
+	VkDeviceSize offset;
+	VkBuffer src = ring.buffer;
+
+	if(allocate(size, offset))
+	{
+		memcpy(static_cast<char*>(ring.mapped) + offset, data, size);
+	}
+	else
+	{
+		//a big mesh or too many uploads in one frame, still a single copy from data
+		FBuffer staging;
+		if(allocator->createBuffer(EMemoryPool::Staging, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, staging) != VK_SUCCESS)
+		{
+			std::cout << "Unable to stage " << size << " bytes, the ring is full and no staging buffer could be made" << std::endl;
+			return false;
+		}
+
+		memcpy(staging.mapped, data, size);
+		vmaFlushAllocation(allocator->getHandle(), staging.allocation, 0, VK_WHOLE_SIZE);
+
+		pendingStagingBuffers.push_back(staging);
+		src = staging.buffer;
+		offset = 0;
+	}
+
+	VkBufferCopy region{};
+	region.srcOffset = offset;
+	region.dstOffset = dstOffset;
+	region.size = size;
+	pendingCopies.push_back({ src, dst, region });
+
+	pendingAcquires.push_back({ dst, dstOffset, size, dstAccess });
+	pendingStages |= dstStage;
+
+	return true;
+}
+
+bool StagingRing::flush(FSubmitSync& graphicsSync)
+{
+	FBatch& batch = batches[currentBatch];
+
+	//already flushed since beginFrame, the copies go with the next frame
+	if (pendingCopies.empty() || batch.submitted)
+		return false;
+
+	//the ring is host coherent in most cases, the flush is free then
+	vmaFlushAllocation(allocator->getHandle(), ring.allocation, 0, VK_WHOLE_SIZE);
+
+	VkCommandBuffer commandBuffer = recorder.beginPrimary();
+
+	for (const FPendingCopy& copy : pendingCopies)
+		vkCmdCopyBuffer(commandBuffer, copy.src, copy.dst, 1, &copy.region);
+
+	if(hasDedicatedQueue())
+	{
+		//release half of the ownership transfer, the graphics queue acquires the buffers in recordAcquireBarriers
+		std::vector<VkBufferMemoryBarrier> releases;
+		releases.reserve(pendingAcquires.size());
+
+		for(const FPendingAcquire& acquire : pendingAcquires)
+		{
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = transferFamily;
+			barrier.dstQueueFamilyIndex = graphicsFamily;
+			barrier.buffer = acquire.buffer;
+			barrier.offset = acquire.offset;
+			barrier.size = acquire.size;
+
+			releases.push_back(barrier);
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, static_cast<uint32_t>(releases.size()), releases.data(), 0, nullptr);
+	}
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	FSubmitSync transferSync;
+
+	if(timeline.isValid())
+	{
+		batch.timelineValue = ++lastTimelineValue;
+		transferSync.signalTimeline(timeline, batch.timelineValue);
+	}
+	else
+	{
+		transferSync.signal(batch.semaphore);
+		vkResetFences(device, 1, &batch.fence);
+	}
+
+	transferSync.apply(submitInfo);
+
+	if(vkQueueSubmit(transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS)
+	{
+		std::cout << "Unable to submit the uploads" << std::endl;
+		return false;
+	}
+
+	batch.submitted = true;
+	batch.reclaimed = false;
+	batch.bytes = pendingBytes;
+	batch.stagingBuffers.swap(pendingStagingBuffers);
+	submitOrder.push_back(currentBatch);
+
+	pendingCopies.clear();
+	pendingBytes = 0;
+
+	//same queue family, the semaphore already orders the copies before the graphics work
+	if(hasDedicatedQueue())
+	{
+		flushedAcquires.insert(flushedAcquires.end(), pendingAcquires.begin(), pendingAcquires.end());
+		flushedStages |= pendingStages;
+	}
+
+	pendingAcquires.clear();
+
+	if (timeline.isValid())
+		graphicsSync.waitTimeline(timeline, pendingStages, batch.timelineValue);
+	else
+		graphicsSync.wait(batch.semaphore, pendingStages);
+
+	pendingStages = 0;
+
+	return true;
+}
+
+void StagingRing::recordAcquireBarriers(VkCommandBuffer commandBuffer)
+{
+	if (flushedAcquires.empty())
+		return;
+
+	std::vector<VkBufferMemoryBarrier> acquires;
+	acquires.reserve(flushedAcquires.size());
+
+	for(const FPendingAcquire& acquire : flushedAcquires)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = acquire.dstAccess;
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		barrier.buffer = acquire.buffer;
+		barrier.offset = acquire.offset;
+		barrier.size = acquire.size;
+
+		acquires.push_back(barrier);
+	}
+
+	//the source stages are the ones the semaphore waits on, so the acquire runs after the wait and the release
+	vkCmdPipelineBarrier(commandBuffer, flushedStages, flushedStages, 0,
+		0, nullptr, static_cast<uint32_t>(acquires.size()), acquires.data(), 0, nullptr);
+
+	flushedAcquires.clear();
+	flushedStages = 0;
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize& offset)
+{
+	if (size > ring.size)
+		return false;
+
+	for(;;)
+	{
+		VkDeviceSize alignedHead = (head + cstagingAlignment - 1) / cstagingAlignment * cstagingAlignment;
+		offset = alignedHead;
+
+		//doesn't fit before the end, the tail of the ring is skipped
+		if (offset + size > ring.size)
+			offset = 0;
+
+		VkDeviceSize consumed = offset == 0 && alignedHead != 0 ? ring.size - head + size : offset + size - head;
+
+		if(usedBytes + consumed <= ring.size)
+		{
+			head = offset + size;
+			usedBytes += consumed;
+			pendingBytes += consumed;
+
+			return true;
+		}
+
+		//waits on the oldest transfer still in flight, never on the graphics queue
+		if (!reclaimOldest())
+			return false;
+	}
+}
+
+bool StagingRing::reclaimOldest()
+{
+	for(uint32_t slot : submitOrder)
+	{
+		if(!batches[slot].reclaimed)
+		{
+			reclaim(batches[slot]);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void StagingRing::reclaim(FBatch& batch)
+{
+	if (batch.reclaimed)
+		return;
+
+	if (timeline.isValid())
+		timeline.wait(batch.timelineValue);
+	else
+		vkWaitForFences(device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+
+	usedBytes -= batch.bytes;
+	batch.bytes = 0;
+	batch.reclaimed = true;
+
+	for (FBuffer& staging : batch.stagingBuffers)
+		allocator->destroyBuffer(staging);
+
+	batch.stagingBuffers.clear();
+
+	//empty, pending copies included, starting over from the beginning keeps the uploads contiguous
+	if (usedBytes == 0)
+		head = 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "CommandRecorder.h"
+#include "MemoryAllocator.h"
+#include "TimelineSemaphore.h"
+
+//a persistently mapped staging buffer used as a ring, every upload of a frame is copied in it
+//and all their copies go in a single command buffer, recorded and submitted once per frame on the transfer queue by flush
+//so an upload between a flush and the next beginFrame just waits for the next flush
+//a frame's slice of the ring is given back once its transfer fence signaled
+//on 1.2 the fences and semaphores are replaced by one timeline, each batch signals the next value of it
+class StagingRing
+{
+	struct FBatch
+	{
+		VkFence fence = VK_NULL_HANDLE;
+		//waited on by the graphics submit that uses the uploads
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		//value of the timeline signaled by this batch
+		uint64_t timelineValue = 0;
+
+		//bytes of the ring held by this batch, wrap around included
+		VkDeviceSize bytes = 0;
+		//the uploads that didn't fit in the ring, freed with the batch
+		std::vector<FBuffer> stagingBuffers;
+
+		bool submitted = false;
+		bool reclaimed = true;
+	};
+
+	struct FPendingCopy
+	{
+		//the ring, or a staging buffer of its own
+		VkBuffer src;
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+
+	//an upload waiting for the graphics queue to take ownership of its buffer
+	struct FPendingAcquire
+	{
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		VkAccessFlags dstAccess;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	MemoryAllocator* allocator = nullptr;
+
+	VkQueue transferQueue = VK_NULL_HANDLE;
+	uint32_t transferFamily = 0;
+	uint32_t graphicsFamily = 0;
+
+	TimelineSemaphore timeline;
+	uint64_t lastTimelineValue = 0;
+
+	FBuffer ring;
+	VkDeviceSize head = 0;
+	VkDeviceSize usedBytes = 0;
+
+	CommandRecorder recorder;
+	std::vector<FBatch> batches;
+	uint32_t currentBatch = 0;
+	//the slot of the last submitted batch, in submission order, to reclaim the oldest first
+	std::vector<uint32_t> submitOrder;
+
+	//what the next flush copies, the bytes they hold aren't given to a batch before it
+	std::vector<FPendingCopy> pendingCopies;
+	VkDeviceSize pendingBytes = 0;
+	std::vector<FBuffer> pendingStagingBuffers;
+
+	std::vector<FPendingAcquire> pendingAcquires;
+	VkPipelineStageFlags pendingStages = 0;
+	//submitted by the last flush, acquired by the next graphics command buffer
+	std::vector<FPendingAcquire> flushedAcquires;
+	VkPipelineStageFlags flushedStages = 0;
+
+public:
+	//transferQueue can be the graphics queue when the device has no dedicated transfer family
+	void init(VkDevice device, MemoryAllocator& allocator, VkDeviceSize capacity, VkQueue transferQueue,
+		uint32_t transferFamily, uint32_t graphicsFamily, uint32_t framesInFlight, bool useTimeline);
+	void destroy();
+
+	//the frame's fence signaled, so the graphics work that waited on this slot's transfer is done too
+	void beginFrame(uint32_t frameIndex);
+
+	//copies data in the ring and queues its copy into dst for the next flush, nothing is allocated
+	//an upload bigger than the ring, or not fitting beside what is queued, gets a staging buffer of its own instead
+	//only fails when that buffer can't be allocated
+	bool upload(const void* data, VkDeviceSize size, VkBuffer dst, VkDeviceSize dstOffset,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	//submits the frame's copies and adds what the graphics submit has to wait on to graphicsSync
+	//returns false if there was nothing to upload
+	bool flush(FSubmitSync& graphicsSync);
+	//records the graphics side of the ownership transfers of the uploads flushed last
+	void recordAcquireBarriers(VkCommandBuffer commandBuffer);
+
+	bool hasDedicatedQueue() const { return transferFamily != graphicsFamily; }
+
+private:
+	bool allocate(VkDeviceSize size, VkDeviceSize& offset);
+	bool reclaimOldest();
+	void reclaim(FBatch& batch);
+};
@@ -0,0 +1,109 @@
+#include "TimelineSemaphore.h"
+
+#include <iostream>
+
+bool TimelineSemaphore::init(VkDevice device, uint64_t initialValue)
+{
+	this->device = device;
+
+	getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue"));
+	waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(vkGetDeviceProcAddr(device, "vkWaitSemaphores"));
+
+	if(getSemaphoreCounterValue == nullptr || waitSemaphores == nullptr)
+	{
+		std::cout << "The device doesn't have the timeline semaphore functions" << std::endl;
+		return false;
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = initialValue;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+
+	if(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+	{
+		std::cout << "Unable to create a timeline semaphore" << std::endl;
+		semaphore = VK_NULL_HANDLE;
+		return false;
+	}
+
+	return true;
+}
+
+void TimelineSemaphore::destroy()
+{
+	if (semaphore != VK_NULL_HANDLE)
+		vkDestroySemaphore(device, semaphore, nullptr);
+
+	semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t TimelineSemaphore::getCompletedValue() const
+{
+	uint64_t value = 0;
+	getSemaphoreCounterValue(device, semaphore, &value);
+
+	return value;
+}
+
+void TimelineSemaphore::wait(uint64_t value) const
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+
+	waitSemaphores(device, &waitInfo, UINT64_MAX);
+}
+
+void FSubmitSync::wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value)
+{
+	waitSemaphores[waitCount] = semaphore;
+	waitStages[waitCount] = stage;
+	waitValues[waitCount] = value;
+	waitCount++;
+}
+
+void FSubmitSync::waitTimeline(const TimelineSemaphore& timeline, VkPipelineStageFlags stage, uint64_t value)
+{
+	wait(timeline.getHandle(), stage, value);
+	usesTimeline = true;
+}
+
+void FSubmitSync::signal(VkSemaphore semaphore, uint64_t value)
+{
+	signalSemaphores[signalCount] = semaphore;
+	signalValues[signalCount] = value;
+	signalCount++;
+}
+
+void FSubmitSync::signalTimeline(const TimelineSemaphore& timeline, uint64_t value)
+{
+	signal(timeline.getHandle(), value);
+	usesTimeline = true;
+}
+
+void FSubmitSync::apply(VkSubmitInfo& submitInfo)
+{
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores;
+	submitInfo.pWaitDstStageMask = waitStages;
+	submitInfo.signalSemaphoreCount = signalCount;
+	submitInfo.pSignalSemaphores = signalSemaphores;
+
+	if(usesTimeline)
+	{
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = waitCount;
+		timelineInfo.pWaitSemaphoreValues = waitValues;
+		timelineInfo.signalSemaphoreValueCount = signalCount;
+		timelineInfo.pSignalSemaphoreValues = signalValues;
+
+		submitInfo.pNext = &timelineInfo;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+//a vulkan 1.2 timeline semaphore, its value only grows
+//one per queue, every submission signals the next value and anyone can wait for an exact one, cpu or gpu
+class TimelineSemaphore
+{
+	VkDevice device = VK_NULL_HANDLE;
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+
+	//looked up, a 1.0 or 1.1 loader doesn't export them and the exe wouldn't even start
+	PFN_vkGetSemaphoreCounterValue getSemaphoreCounterValue = nullptr;
+	PFN_vkWaitSemaphores waitSemaphores = nullptr;
+
+public:
+	bool init(VkDevice device, uint64_t initialValue = 0);
+	void destroy();
+
+	VkSemaphore getHandle() const { return semaphore; }
+	bool isValid() const { return semaphore != VK_NULL_HANDLE; }
+
+	//value of the last submission the gpu is done with
+	uint64_t getCompletedValue() const;
+	//blocks the cpu until the semaphore reaches value
+	void wait(uint64_t value) const;
+};
+
+//the semaphores of one vkQueueSubmit, binary and timeline ones mixed
+//the values of the binary ones are ignored, the timeline info is only chained when timelines are used
+struct FSubmitSync
+{
+	static constexpr uint32_t cmaxSemaphores = 4;
+
+	VkSemaphore waitSemaphores[cmaxSemaphores];
+	VkPipelineStageFlags waitStages[cmaxSemaphores];
+	uint64_t waitValues[cmaxSemaphores];
+	uint32_t waitCount = 0;
+
+	VkSemaphore signalSemaphores[cmaxSemaphores];
+	uint64_t signalValues[cmaxSemaphores];
+	uint32_t signalCount = 0;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	bool usesTimeline = false;
+
+	void wait(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value = 0);
+	void waitTimeline(const TimelineSemaphore& timeline, VkPipelineStageFlags stage, uint64_t value);
+	void signal(VkSemaphore semaphore, uint64_t value = 0);
+	void signalTimeline(const TimelineSemaphore& timeline, uint64_t value);
+
+	//submitInfo keeps pointing in this struct, it has to stay alive until the submit
+	void apply(VkSubmitInfo& submitInfo);
+};
@@ -0,0 +1,29 @@
+#include "VertexLayout.h"
+
+VertexLayout::VertexLayout(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate, uint32_t firstLocation)
+	: binding(binding), stride(stride), inputRate(inputRate), firstLocation(firstLocation)
+{
+}
+
+VertexLayout& VertexLayout::addAttribute(VkFormat format, uint32_t offset)
+{
+	VkVertexInputAttributeDescription attribute{};
+	attribute.binding = binding;
+	attribute.location = firstLocation + static_cast<uint32_t>(attributes.size());
+	attribute.format = format;
+	attribute.offset = offset;
+
+	attributes.push_back(attribute);
+
+	return *this;
+}
+
+VkVertexInputBindingDescription VertexLayout::getBindingDescription() const
+{
+	VkVertexInputBindingDescription description{};
+	description.binding = binding;
+	description.stride = stride;
+	description.inputRate = inputRate;
+
+	return description;
+}
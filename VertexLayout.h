@@ -0,0 +1,27 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+//describes how the vertices of a buffer are laid out, and fills the pipeline's vertex input from it
+//attributes get their location in the order they are added, from firstLocation
+//a per instance stream is another layout on its own binding, with its locations after the vertex ones
+class VertexLayout
+{
+	uint32_t binding = 0;
+	uint32_t stride = 0;
+	VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	uint32_t firstLocation = 0;
+
+	std::vector<VkVertexInputAttributeDescription> attributes;
+
+public:
+	VertexLayout() = default;
+	VertexLayout(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX, uint32_t firstLocation = 0);
+
+	VertexLayout& addAttribute(VkFormat format, uint32_t offset);
+
+	VkVertexInputBindingDescription getBindingDescription() const;
+	const std::vector<VkVertexInputAttributeDescription>& getAttributeDescriptions() const { return attributes; }
+
+	uint32_t getStride() const { return stride; }
+};
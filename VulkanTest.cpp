@@ -6,14 +6,101 @@
 
 #include "Application.h"
 
+#include <cstdlib>
+#include <cstring>
+
 constexpr int32_t height = 600;
 constexpr int32_t width = 800;
 
 
-int main() {
-    Application app(height, width, "Testing Vulkan");
+int main(int argc, char** argv) {
+    //--trace <file> can follow any mode, the zones are only recorded when it's there
+    const char* tracePath = nullptr;
+
+    if (argc > 2 && strcmp(argv[argc - 2], "--trace") == 0)
+    {
+        tracePath = argv[argc - 1];
+        argc -= 2;
+        CpuProfiler::setEnabled(true);
+    }
+
+    //--headless can come before any mode, it renders offscreen without a window
+    bool headless = false;
+
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+    {
+        headless = true;
+        argv++;
+        argc--;
+    }
+
+    //--device <index or name> too, it wins over the VULKAN_DISCOVERY_DEVICE environment variable
+    const char* deviceSelector = nullptr;
+
+    if (argc > 2 && strcmp(argv[1], "--device") == 0)
+    {
+        deviceSelector = argv[2];
+        argv += 2;
+        argc -= 2;
+    }
+
+    Application app(height, width, "Testing Vulkan", headless, deviceSelector);
+
+    if (argc > 1 && strcmp(argv[1], "--resize-storm") == 0)
+    {
+        uint32_t resizes = argc > 2 ? std::atoi(argv[2]) : 100;
+        app.runResizeStorm(resizes);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench-command-reset") == 0)
+        app.runCommandResetBenchmark();
+    else if (argc > 1 && strcmp(argv[1], "--bench-recording") == 0)
+    {
+        uint32_t draws = argc > 2 ? std::atoi(argv[2]) : 50000;
+        app.runRecordingBenchmark(draws);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench-frames-in-flight") == 0)
+    {
+        uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 300;
+        app.runFramesInFlightBenchmark(frames);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench-async-compute") == 0)
+    {
+        uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 300;
+        uint32_t particles = argc > 3 ? std::atoi(argv[3]) : 262144;
+        app.runAsyncComputeBenchmark(frames, particles);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench-instancing") == 0)
+    {
+        uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 300;
+        uint32_t instances = argc > 3 ? std::atoi(argv[3]) : 100000;
+        app.runInstancingBenchmark(frames, instances);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench-gpu-driven") == 0)
+    {
+        uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 300;
+        app.runGpuDrivenBenchmark(frames);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench-async-load") == 0)
+    {
+        const char* path = argc > 2 ? argv[2] : "Shaders/vert.spv";
+        app.runAsyncLoadBenchmark(path);
+    }
+    else if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+    {
+        uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 500;
+        const char* output = argc > 3 ? argv[3] : "benchmark.json";
+        app.runBenchmark(frames, output);
+    }
+    else if (headless)
+    {
+        uint32_t frames = argc > 1 ? std::atoi(argv[1]) : 300;
+        app.runFrames(frames);
+    }
+    else
+        app.run();
 
-    app.run();
+    if (tracePath != nullptr)
+        app.exportTrace(tracePath);
 
     return 0;
 }